@@ -0,0 +1,616 @@
+// Offline benchmark of the stages of asciify on a synthetic corpus. Every
+// measurement is printed as one JSON object per line.
+
+#define _POSIX_C_SOURCE 200809L
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+#include <stb/stb_image_resize.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ansi.h"
+#include "decode.h"
+#include "edge.h"
+#include "frame.h"
+#include "luma.h"
+#include "render.h"
+#include "shape.h"
+#include "xterm.h"
+
+// each measurement repeats until it took at least this long
+#define BENCH_NS 200000000LL
+
+static const struct {
+    int width;
+    int height;
+} image_sizes[] = {
+    {320, 240},
+    {1280, 720},
+    {3840, 2160},
+};
+
+static const struct {
+    int columns;
+    int rows;
+} grid_sizes[] = {
+    {80, 24},
+    {200, 60},
+    {400, 120},
+};
+
+// Render options measured for the output stage, by name.
+static const struct {
+    const char* name;
+    render_opts opts;
+} render_sets[] = {
+    {"plain", {.detail = 1}},
+    {"edge", {.detail = 1, .edge = true}},
+    {"ansi", {.detail = 1, .ansi = true}},
+    {"xterm", {.detail = 1, .xterm = true}},
+    {"xterm-quant", {.detail = 1, .xterm = true, .quant = 4, .has_quant = 1}},
+    {"truecolor", {.detail = 1, .truecolor = true}},
+    {"xterm-ordered", {.detail = 1, .xterm = true, .dither = DITHER_ORDERED}},
+    {"xterm-diffuse", {.detail = 1, .xterm = true, .dither = DITHER_DIFFUSE}},
+    {"half", {.detail = 1, .truecolor = true, .mode = RENDER_HALF}},
+    {"braille", {.detail = 1, .mode = RENDER_BRAILLE}},
+    {"shape", {.detail = 1, .mode = RENDER_SHAPE}},
+};
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Run `step(data)` until `BENCH_NS` passed, returns the nanoseconds per run.
+static double measure(void (*step)(void* data), void* data, int64_t* runs) {
+    // once to warm up the caches and the lazily built tables
+    step(data);
+
+    int64_t count = 0;
+    int64_t start = now_ns();
+    int64_t spent;
+
+    do {
+        step(data);
+        count++;
+        spent = now_ns() - start;
+    } while (spent < BENCH_NS);
+
+    *runs = count;
+
+    return (double) spent / count;
+}
+
+// Print the result of one measurement. `items` is what one run processes,
+// in `unit`, for the throughput.
+static void report(
+    const char* stage,
+    const char* variant,
+    int         width,
+    int         height,
+    int64_t     runs,
+    double      ns,
+    double      items,
+    const char* unit
+) {
+    printf(
+        "{\"stage\": \"%s\", \"variant\": \"%s\", \"width\": %d, "
+        "\"height\": %d, \"runs\": %lld, \"ns_per_run\": %.0f, "
+        "\"%s_per_s\": %.0f}\n",
+        stage,
+        variant,
+        width,
+        height,
+        (long long) runs,
+        ns,
+        unit,
+        items * 1e9 / ns
+    );
+
+    fflush(stdout);
+}
+
+// xorshift32, so the corpus is the same on every run
+static uint32_t next_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+// Gradients, rings and a little noise, with both flat and detailed areas.
+static uint8_t* synthetic_image(int width, int height) {
+    uint8_t* image = malloc((size_t) width * height * 4);
+    uint32_t state = 0x9e3779b9;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image + ((size_t) y * width + x) * 4;
+
+            int dx = x - width / 2;
+            int dy = y - height / 2;
+            int d  = (dx * dx + dy * dy) / (width / 8 + 1);
+
+            p[0] = x * 255 / width;
+            p[1] = y * 255 / height;
+            p[2] = (d & 64 ? 255 - p[0] : p[0]) ^ (next_random(&state) & 15);
+            p[3] = 255;
+        }
+    }
+
+    return image;
+}
+
+typedef struct encoded {
+    uint8_t* data;
+    size_t   size;
+    size_t   capacity;
+} encoded;
+
+static void encoded_push(encoded* out, const void* data, size_t size) {
+    if (out->size + size > out->capacity) {
+        out->capacity = (out->size + size) * 2;
+        out->data     = realloc(out->data, out->capacity);
+    }
+
+    memcpy(out->data + out->size, data, size);
+    out->size += size;
+}
+
+static void encoded_write(void* context, void* data, int size) {
+    encoded_push(context, data, size);
+}
+
+static void encoded_byte(encoded* out, uint8_t byte) {
+    encoded_push(out, &byte, 1);
+}
+
+// Single frame GIF with a 3-3-2 palette. The LZW stream only uses literal
+// codes, with a clear code before the code size would grow.
+static void encode_gif(
+    encoded*       out,
+    const uint8_t* image,
+    int            width,
+    int            height
+) {
+    uint8_t header[13] = {'G', 'I', 'F', '8', '9', 'a'};
+
+    header[6]  = width & 0xff;
+    header[7]  = width >> 8;
+    header[8]  = height & 0xff;
+    header[9]  = height >> 8;
+    header[10] = 0xf7; // global palette of 256 colors
+
+    encoded_push(out, header, sizeof header);
+
+    for (int i = 0; i < 256; i++) {
+        encoded_byte(out, (i >> 5) * 255 / 7);
+        encoded_byte(out, (i >> 2 & 7) * 255 / 7);
+        encoded_byte(out, (i & 3) * 255 / 3);
+    }
+
+    uint8_t descriptor[11] = {',', 0, 0, 0, 0};
+
+    descriptor[5]  = width & 0xff;
+    descriptor[6]  = width >> 8;
+    descriptor[7]  = height & 0xff;
+    descriptor[8]  = height >> 8;
+    descriptor[10] = 8; // minimum code size
+
+    encoded_push(out, descriptor, sizeof descriptor);
+
+    uint8_t  block[256];
+    int      block_len = 0;
+    uint32_t bits      = 0;
+    int      bit_count = 0;
+
+#define PUT_CODE(code)                                    \
+    do {                                                  \
+        bits |= (uint32_t) (code) << bit_count;           \
+        bit_count += 9;                                   \
+        while (bit_count >= 8) {                          \
+            block[1 + block_len++] = bits & 0xff;         \
+            bits >>= 8;                                   \
+            bit_count -= 8;                               \
+            if (block_len == 255) {                       \
+                block[0] = 255;                           \
+                encoded_push(out, block, 256);            \
+                block_len = 0;                            \
+            }                                             \
+        }                                                 \
+    } while (0)
+
+    size_t count = (size_t) width * height;
+
+    for (size_t i = 0; i < count; i++) {
+        // the decoder adds a code per literal, 250 of them keep it at 9 bits
+        if (i % 250 == 0) PUT_CODE(256);
+
+        const uint8_t* p = image + i * 4;
+
+        PUT_CODE((p[0] & 0xe0) | (p[1] >> 3 & 0x1c) | p[2] >> 6);
+    }
+
+    PUT_CODE(257);
+
+    if (bit_count > 0) block[1 + block_len++] = bits & 0xff;
+
+#undef PUT_CODE
+
+    if (block_len > 0) {
+        block[0] = block_len;
+        encoded_push(out, block, block_len + 1);
+    }
+
+    encoded_byte(out, 0);
+    encoded_byte(out, ';');
+}
+
+typedef struct decode_step {
+    encoded data;
+
+    // smallest size asked of `decode_image`, JPEGs decode at a reduced DCT
+    // scale when it is below the image size
+    int min_width;
+    int min_height;
+} decode_step;
+
+static void run_decode(void* data) {
+    decode_step* step = data;
+    int          width, height;
+
+    uint8_t* image = decode_image(
+        step->data.data,
+        step->data.size,
+        step->min_width,
+        step->min_height,
+        &width,
+        &height
+    );
+
+    decode_free(image);
+}
+
+// Encode `image` as PNG, JPEG and GIF and time decoding each at full size
+// and for the pixels of each grid of one pixel per cell. Variants for a grid
+// are named `<format>@<columns>x<rows>`.
+static void bench_decode(const uint8_t* image, int width, int height) {
+    const char* formats[] = {"png", "jpeg", "gif"};
+
+    for (size_t f = 0; f < COUNT(formats); f++) {
+        decode_step step = {0};
+
+        switch (f) {
+        case 0:
+            stbi_write_png_to_func(
+                encoded_write,
+                &step.data,
+                width,
+                height,
+                4,
+                image,
+                width * 4
+            );
+            break;
+        case 1:
+            stbi_write_jpg_to_func(
+                encoded_write,
+                &step.data,
+                width,
+                height,
+                4,
+                image,
+                90
+            );
+            break;
+        case 2:
+            encode_gif(&step.data, image, width, height);
+            break;
+        }
+
+        int decoded_width, decoded_height;
+
+        uint8_t* check = decode_image(
+            step.data.data,
+            step.data.size,
+            width,
+            height,
+            &decoded_width,
+            &decoded_height
+        );
+
+        if (!check) {
+            fprintf(stderr, "bench: cannot decode %s\n", formats[f]);
+            free(step.data.data);
+            continue;
+        }
+
+        decode_free(check);
+
+        // at full size, then for each grid, as `convert_image` asks for it
+        for (size_t g = 0; g <= COUNT(grid_sizes); g++) {
+            char variant[32];
+
+            if (g == 0) {
+                step.min_width  = width;
+                step.min_height = height;
+
+                snprintf(variant, sizeof variant, "%s", formats[f]);
+            } else {
+                step.min_width  = grid_sizes[g - 1].columns;
+                step.min_height = grid_sizes[g - 1].rows;
+
+                snprintf(
+                    variant,
+                    sizeof variant,
+                    "%s@%dx%d",
+                    formats[f],
+                    step.min_width,
+                    step.min_height
+                );
+            }
+
+            int64_t runs;
+            double  ns = measure(run_decode, &step, &runs);
+
+            report(
+                "decode",
+                variant,
+                width,
+                height,
+                runs,
+                ns,
+                (double) width * height,
+                "pixels"
+            );
+        }
+
+        free(step.data.data);
+    }
+}
+
+typedef struct resize_step {
+    const uint8_t* image;
+    int            width;
+    int            height;
+    uint8_t*       scaled;
+    int            scaled_width;
+    int            scaled_height;
+} resize_step;
+
+static void run_resize(void* data) {
+    resize_step* step = data;
+
+    stbir_resize_uint8(
+        step->image,
+        step->width,
+        step->height,
+        step->width * 4,
+        step->scaled,
+        step->scaled_width,
+        step->scaled_height,
+        step->scaled_width * 4,
+        4
+    );
+}
+
+typedef struct pixel_step {
+    const uint8_t* image;
+    uint16_t*      luma;
+    uint8_t*       out;
+    int            width;
+    int            height;
+} pixel_step;
+
+static void run_luma(void* data) {
+    pixel_step* step = data;
+
+    luma_plane(step->luma, step->image, (size_t) step->width * step->height);
+}
+
+static void run_edge(void* data) {
+    pixel_step* step = data;
+
+    for (int y = 1; y < step->height - 1; y++) {
+        edge_row(
+            step->out,
+            step->luma + (size_t) y * step->width,
+            step->width
+        );
+    }
+}
+
+static void run_xterm(void* data) {
+    pixel_step* step = data;
+
+    for (int y = 0; y < step->height; y++) {
+        xterm_map_row(
+            step->out,
+            step->image + (size_t) y * step->width * 4,
+            step->width
+        );
+    }
+}
+
+static void run_ansi(void* data) {
+    pixel_step* step = data;
+
+    for (int y = 0; y < step->height; y++) {
+        ansi_map_row(
+            step->out,
+            step->image + (size_t) y * step->width * 4,
+            step->width,
+            NULL,
+            255
+        );
+    }
+}
+
+typedef struct render_step {
+    const uint8_t* image;
+    render_opts    opts;
+    frame          frame;
+} render_step;
+
+static void run_render(void* data) {
+    render_step* step = data;
+
+    frame_clear(&step->frame);
+    render(&step->frame, step->image, &step->opts, NULL);
+}
+
+// Everything after decoding, for an image of `width` by `height` pixels
+// drawn on a grid of `columns` by `rows` cells.
+static void bench_grid(
+    const uint8_t* image,
+    int            width,
+    int            height,
+    int            columns,
+    int            rows
+) {
+    resize_step resize = {
+        .image         = image,
+        .width         = width,
+        .height        = height,
+        .scaled        = malloc((size_t) columns * rows * 4),
+        .scaled_width  = columns,
+        .scaled_height = rows,
+    };
+
+    int64_t runs;
+    double  ns = measure(run_resize, &resize, &runs);
+
+    report(
+        "resize",
+        "ascii",
+        columns,
+        rows,
+        runs,
+        ns,
+        (double) width * height,
+        "pixels"
+    );
+
+    size_t cells = (size_t) columns * rows;
+
+    pixel_step pixel = {
+        .image  = resize.scaled,
+        .luma   = malloc(cells * 2),
+        .out    = malloc(columns),
+        .width  = columns,
+        .height = rows,
+    };
+
+    const struct {
+        const char* stage;
+        const char* variant;
+        void (*run)(void* data);
+    } pixel_stages[] = {
+        {"luma", "rec709", run_luma},
+        {"edge", "sobel", run_edge},
+        {"color", "xterm", run_xterm},
+        {"color", "ansi", run_ansi},
+    };
+
+    for (size_t i = 0; i < COUNT(pixel_stages); i++) {
+        ns = measure(pixel_stages[i].run, &pixel, &runs);
+
+        report(
+            pixel_stages[i].stage,
+            pixel_stages[i].variant,
+            columns,
+            rows,
+            runs,
+            ns,
+            (double) cells,
+            "cells"
+        );
+    }
+
+    free(pixel.luma);
+    free(pixel.out);
+    free(resize.scaled);
+
+    for (size_t i = 0; i < COUNT(render_sets); i++) {
+        render_step step = {.opts = render_sets[i].opts};
+
+        step.opts.width  = columns;
+        step.opts.height = rows;
+
+        int pixel_width, pixel_height;
+        render_pixels(&step.opts, &pixel_width, &pixel_height);
+
+        uint8_t* scaled = malloc((size_t) pixel_width * pixel_height * 4);
+
+        stbir_resize_uint8(
+            image,
+            width,
+            height,
+            width * 4,
+            scaled,
+            pixel_width,
+            pixel_height,
+            pixel_width * 4,
+            4
+        );
+
+        step.image = scaled;
+        frame_init(&step.frame, 0);
+
+        ns = measure(run_render, &step, &runs);
+
+        report(
+            "output",
+            render_sets[i].name,
+            columns,
+            rows,
+            runs,
+            ns,
+            (double) cells,
+            "cells"
+        );
+
+        frame_free(&step.frame);
+        free(scaled);
+    }
+}
+
+int main(void) {
+    xterm_init();
+    shape_init();
+
+    for (size_t i = 0; i < COUNT(image_sizes); i++) {
+        int width  = image_sizes[i].width;
+        int height = image_sizes[i].height;
+
+        uint8_t* image = synthetic_image(width, height);
+
+        bench_decode(image, width, height);
+
+        // the grids are only measured from the middle size
+        if (i == 1) {
+            for (size_t g = 0; g < COUNT(grid_sizes); g++) {
+                bench_grid(
+                    image,
+                    width,
+                    height,
+                    grid_sizes[g].columns,
+                    grid_sizes[g].rows
+                );
+            }
+        }
+
+        free(image);
+    }
+
+    return 0;
+}
@@ -4,6 +4,7 @@ pkgs.mkShell {
   buildInputs = [
     pkgs.clang-tools
     pkgs.curl
+    pkgs.libjpeg
     pkgs.stb
   ];
 }
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ANSI foreground color code matching the hue of the RGB color with
+// channels in `0..scale`, or 0 if the color is too close to gray.
+uint8_t ansi_classify(int32_t r, int32_t g, int32_t b, int32_t scale);
+
+// Classify `count` RGBA pixels. If `levels` is not null each channel is
+// first mapped through it and classified in `0..scale`, otherwise the
+// channels are classified as they are, in `0..255`.
+void ansi_map_row(
+    uint8_t*        out,
+    const uint8_t*  rgba,
+    size_t          count,
+    const uint16_t* levels,
+    int32_t         scale
+);
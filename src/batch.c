@@ -0,0 +1,318 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "batch.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "convert.h"
+#include "decode.h"
+#include "frame.h"
+#include "input.h"
+
+// State shared by the workers of a batch.
+typedef struct batch_job {
+    const batch_opts* opts;
+
+    char** paths;
+    size_t count;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  freed;
+
+    // next path to convert
+    size_t next;
+    // bytes of decoded images held by the workers
+    size_t memory;
+    size_t failed;
+} batch_job;
+
+static bool batch_push(
+    char***     paths,
+    size_t*     count,
+    const char* path,
+    size_t      len
+) {
+    char** grown = realloc(*paths, (*count + 1) * sizeof *grown);
+    if (!grown) return false;
+
+    *paths = grown;
+
+    char* copy = malloc(len + 1);
+    if (!copy) return false;
+
+    memcpy(copy, path, len);
+    copy[len] = '\0';
+
+    (*paths)[(*count)++] = copy;
+
+    return true;
+}
+
+static int batch_path_order(const void* a, const void* b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+// Collect the regular files in `dir`, sorted by name.
+static bool batch_list_dir(const char* dir, char*** paths, size_t* count) {
+    DIR* d = opendir(dir);
+    if (!d) return false;
+
+    struct dirent* ent;
+    bool           ok = true;
+
+    while (ok && (ent = readdir(d))) {
+        if (ent->d_name[0] == '.') continue;
+
+        size_t len  = snprintf(NULL, 0, "%s/%s", dir, ent->d_name);
+        char*  path = malloc(len + 1);
+
+        if (!path) {
+            ok = false;
+            break;
+        }
+
+        snprintf(path, len + 1, "%s/%s", dir, ent->d_name);
+
+        struct stat st;
+
+        if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+            ok = batch_push(paths, count, path, len);
+        }
+
+        free(path);
+    }
+
+    closedir(d);
+
+    qsort(*paths, *count, sizeof **paths, batch_path_order);
+
+    return ok;
+}
+
+// Collect the paths listed in `file`, one per line.
+static bool batch_list_file(const char* file, char*** paths, size_t* count) {
+    image_data list;
+
+    if (!input_file(&list, file)) return false;
+
+    const char* data = (const char*) list.data;
+    const char* end  = data + list.size;
+    bool        ok   = true;
+
+    while (ok && data < end) {
+        const char* newline = memchr(data, '\n', end - data);
+        size_t      len     = (newline ? newline : end) - data;
+
+        if (len > 0 && data[len - 1] == '\r') len--;
+
+        if (len > 0) ok = batch_push(paths, count, data, len);
+
+        data = newline ? newline + 1 : end;
+    }
+
+    free_image_data(&list);
+
+    return ok;
+}
+
+// File name of `path`, which its output is named after.
+static const char* batch_name(const char* path) {
+    const char* name = strrchr(path, '/');
+    return name ? name + 1 : path;
+}
+
+static int batch_name_order(const void* a, const void* b) {
+    return strcmp(
+        batch_name(*(char* const*) a),
+        batch_name(*(char* const*) b)
+    );
+}
+
+// Report paths with the same file name, their outputs would overwrite each
+// other.
+static bool batch_unique(char** paths, size_t count) {
+    if (count < 2) return true;
+
+    char** sorted = malloc(count * sizeof *sorted);
+    if (!sorted) return false;
+
+    memcpy(sorted, paths, count * sizeof *sorted);
+    qsort(sorted, count, sizeof *sorted, batch_name_order);
+
+    bool unique = true;
+
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(batch_name(sorted[i - 1]), batch_name(sorted[i])) == 0) {
+            printf(
+                "`%s` and `%s` would have the same output\n",
+                sorted[i - 1],
+                sorted[i]
+            );
+            unique = false;
+        }
+    }
+
+    free(sorted);
+
+    return unique;
+}
+
+// Name of the output for `path`, its file name with `.txt` appended.
+static char* batch_output(const char* dir, const char* path) {
+    const char* name = batch_name(path);
+
+    size_t size   = snprintf(NULL, 0, "%s/%s.txt", dir, name);
+    char*  output = malloc(size + 1);
+
+    if (output) snprintf(output, size + 1, "%s/%s.txt", dir, name);
+
+    return output;
+}
+
+// Wait until `size` more bytes of decoded images fit into the budget. A
+// single image larger than the whole budget still runs, alone.
+static void batch_acquire(batch_job* job, size_t size) {
+    pthread_mutex_lock(&job->lock);
+
+    while (job->opts->memory && job->memory > 0 &&
+           job->memory + size > job->opts->memory) {
+        pthread_cond_wait(&job->freed, &job->lock);
+    }
+
+    job->memory += size;
+
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void batch_release(batch_job* job, size_t size) {
+    pthread_mutex_lock(&job->lock);
+
+    job->memory -= size;
+    pthread_cond_broadcast(&job->freed);
+
+    pthread_mutex_unlock(&job->lock);
+}
+
+static bool batch_convert(batch_job* job, frame* frame, const char* path) {
+    const batch_opts* opts = job->opts;
+
+    image_data data;
+
+    if (!input_file(&data, path)) return false;
+
+    int width, height;
+
+    if (!decode_info(data.data, data.size, &width, &height)) {
+        free_image_data(&data);
+        return false;
+    }
+
+    // the decoded image, JPEGs decoded at a reduced scale need less
+    size_t memory = (size_t) width * height * 4;
+
+    batch_acquire(job, memory);
+
+    frame_clear(frame);
+
+    bool converted = convert_image(
+        frame,
+        data.data,
+        data.size,
+        opts->render,
+        opts->fit_width,
+        opts->fit_height,
+        NULL
+    );
+
+    batch_release(job, memory);
+    free_image_data(&data);
+
+    if (!converted) return false;
+
+    char* output = batch_output(opts->output, path);
+    if (!output) return false;
+
+    int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    free(output);
+
+    if (fd < 0) return false;
+
+    bool written = frame_flush(frame, fd);
+
+    return close(fd) == 0 && written;
+}
+
+static void batch_task(void* data, int worker) {
+    (void) worker;
+
+    batch_job* job = data;
+
+    frame frame;
+    frame_init(&frame, 0);
+
+    while (true) {
+        pthread_mutex_lock(&job->lock);
+        size_t index = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (index >= job->count) break;
+
+        if (!batch_convert(job, &frame, job->paths[index])) {
+            printf("could not convert `%s`\n", job->paths[index]);
+
+            pthread_mutex_lock(&job->lock);
+            job->failed += 1;
+            pthread_mutex_unlock(&job->lock);
+        }
+    }
+
+    frame_free(&frame);
+}
+
+bool batch_run(const char* input, const batch_opts* opts, pool* pool) {
+    char** paths = NULL;
+    size_t count = 0;
+
+    struct stat st;
+
+    bool listed = stat(input, &st) == 0 &&
+                  (S_ISDIR(st.st_mode)
+                       ? batch_list_dir(input, &paths, &count)
+                       : batch_list_file(input, &paths, &count));
+
+    if (!listed) {
+        printf("could not list `%s`\n", input);
+    } else if (!batch_unique(paths, count)) {
+        listed = false;
+    } else if (mkdir(opts->output, 0755) != 0 && errno != EEXIST) {
+        printf("could not create `%s`\n", opts->output);
+        listed = false;
+    }
+
+    batch_job job = {
+        .opts  = opts,
+        .paths = paths,
+        .count = listed ? count : 0,
+    };
+
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.freed, NULL);
+
+    pool_run(pool, batch_task, &job, pool_threads(pool));
+
+    pthread_mutex_destroy(&job.lock);
+    pthread_cond_destroy(&job.freed);
+
+    for (size_t i = 0; i < count; i++) free(paths[i]);
+    free(paths);
+
+    return listed && job.failed == 0;
+}
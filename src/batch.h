@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pool.h"
+#include "render.h"
+
+typedef struct batch_opts {
+    // width and height of 0 follow the aspect ratio, as in `convert_image`
+    render_opts render;
+    int         fit_width;
+    int         fit_height;
+
+    // directory the renderings are written to
+    const char* output;
+
+    // bytes of decoded images in flight at once, 0 for no limit
+    size_t memory;
+} batch_opts;
+
+// Render every image in `input` to `<output>/<file name>.txt`, such as
+// `a.jpg.txt`, running one image per thread of `pool`. `input` is either a
+// directory or a file listing one path per line. Fails without converting
+// anything if two paths have the same file name, and fails if any image
+// could not be converted.
+bool batch_run(const char* input, const batch_opts* opts, pool* pool);
@@ -0,0 +1,361 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct cache {
+    char*  dir;
+    size_t budget;
+};
+
+// Start of every cache file, followed by the URL, the ETag, the
+// Last-Modified date and the body.
+typedef struct cache_header {
+    char     magic[8];
+    int64_t  expires;
+    uint32_t url_len;
+    uint32_t etag_len;
+    uint32_t modified_len;
+    uint32_t reserved;
+    uint64_t size;
+} cache_header;
+
+static const char cache_magic[8] = "ASCIIFY";
+
+// length of a file name, the URL hash in hex
+#define CACHE_NAME_LEN 16
+
+static bool make_dirs(char* path) {
+    for (char* p = path + 1; *p; p++) {
+        if (*p != '/') continue;
+
+        *p = '\0';
+        int result = mkdir(path, 0755);
+        *p = '/';
+
+        if (result != 0 && errno != EEXIST) return false;
+    }
+
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+cache* cache_open(size_t budget) {
+    const char* base   = getenv("XDG_CACHE_HOME");
+    const char* suffix = "asciify";
+
+    if (!base || !*base) {
+        base   = getenv("HOME");
+        suffix = ".cache/asciify";
+    }
+
+    if (!base || !*base) return NULL;
+
+    size_t len = snprintf(NULL, 0, "%s/%s", base, suffix);
+    char*  dir = malloc(len + 1);
+
+    if (!dir) return NULL;
+
+    snprintf(dir, len + 1, "%s/%s", base, suffix);
+
+    cache* cache = malloc(sizeof *cache);
+
+    if (!cache || !make_dirs(dir)) {
+        free(cache);
+        free(dir);
+        return NULL;
+    }
+
+    cache->dir    = dir;
+    cache->budget = budget;
+
+    return cache;
+}
+
+void cache_close(cache* cache) {
+    if (!cache) return;
+
+    free(cache->dir);
+    free(cache);
+}
+
+// 64-bit FNV-1a.
+static uint64_t cache_hash(const char* url) {
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (const char* c = url; *c; c++) {
+        hash ^= (uint8_t) *c;
+        hash *= 0x100000001b3;
+    }
+
+    return hash;
+}
+
+// Path of the file for `url`, with `suffix` appended.
+static char* cache_path(cache* cache, const char* url, const char* suffix) {
+    unsigned long long hash = cache_hash(url);
+
+    size_t len = snprintf(NULL, 0, "%s/%016llx%s", cache->dir, hash, suffix);
+
+    char* path = malloc(len + 1);
+
+    if (path) {
+        snprintf(path, len + 1, "%s/%016llx%s", cache->dir, hash, suffix);
+    }
+
+    return path;
+}
+
+static bool write_all(int fd, const void* data, size_t size) {
+    const uint8_t* bytes = data;
+
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        bytes += written;
+        size  -= written;
+    }
+
+    return true;
+}
+
+bool cache_lookup(cache* cache, const char* url, cache_entry* entry) {
+    *entry = (cache_entry) {0};
+
+    char* path = cache_path(cache, url, "");
+    if (!path) return false;
+
+    int fd = open(path, O_RDONLY);
+    free(path);
+
+    if (fd < 0) return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(cache_header)) {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the modification time is when the entry was last used
+    futimens(fd, NULL);
+    close(fd);
+
+    if (map == MAP_FAILED) return false;
+
+    cache_header header;
+    memcpy(&header, map, sizeof header);
+
+    const char* strings = (const char*) map + sizeof header;
+    size_t      url_len = strlen(url);
+
+    uint64_t total = sizeof header + (uint64_t) header.url_len +
+                     header.etag_len + header.modified_len + header.size;
+
+    // also rejects another URL with the same hash
+    bool valid = memcmp(header.magic, cache_magic, sizeof cache_magic) == 0 &&
+                 total == (uint64_t) st.st_size &&
+                 header.url_len == url_len &&
+                 header.etag_len < sizeof entry->validators.etag &&
+                 header.modified_len < sizeof entry->validators.modified &&
+                 memcmp(strings, url, url_len) == 0;
+
+    if (!valid) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    strings += header.url_len;
+    memcpy(entry->validators.etag, strings, header.etag_len);
+
+    strings += header.etag_len;
+    memcpy(entry->validators.modified, strings, header.modified_len);
+
+    strings += header.modified_len;
+
+    entry->data               = (const uint8_t*) strings;
+    entry->size               = header.size;
+    entry->map                = map;
+    entry->map_size           = st.st_size;
+    entry->validators.expires = header.expires;
+    entry->fresh              = time(NULL) < header.expires;
+
+    return true;
+}
+
+void cache_release(cache_entry* entry) {
+    if (entry->map) munmap(entry->map, entry->map_size);
+
+    *entry = (cache_entry) {0};
+}
+
+typedef struct cache_file {
+    char            name[CACHE_NAME_LEN + 1];
+    struct timespec used;
+    off_t           size;
+} cache_file;
+
+static int cache_file_order(const void* a, const void* b) {
+    const struct timespec* x = &((const cache_file*) a)->used;
+    const struct timespec* y = &((const cache_file*) b)->used;
+
+    if (x->tv_sec != y->tv_sec) return x->tv_sec < y->tv_sec ? -1 : 1;
+    if (x->tv_nsec != y->tv_nsec) return x->tv_nsec < y->tv_nsec ? -1 : 1;
+
+    return 0;
+}
+
+// Remove the least recently used files until the cache fits its budget.
+static void cache_evict(cache* cache) {
+    DIR* dir = opendir(cache->dir);
+    if (!dir) return;
+
+    cache_file* files = NULL;
+    size_t      count = 0;
+    size_t      cap   = 0;
+    uint64_t    total = 0;
+
+    struct dirent* ent;
+
+    while ((ent = readdir(dir))) {
+        // skip anything that is not an entry, like files being written
+        if (strlen(ent->d_name) != CACHE_NAME_LEN ||
+            strspn(ent->d_name, "0123456789abcdef") != CACHE_NAME_LEN) {
+            continue;
+        }
+
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0) continue;
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 64;
+
+            cache_file* grown = realloc(files, cap * sizeof *files);
+
+            if (!grown) break;
+
+            files = grown;
+        }
+
+        memcpy(files[count].name, ent->d_name, CACHE_NAME_LEN + 1);
+        files[count].used = st.st_mtim;
+        files[count].size = st.st_size;
+
+        total += st.st_size;
+        count += 1;
+    }
+
+    if (total > cache->budget) {
+        qsort(files, count, sizeof *files, cache_file_order);
+
+        for (size_t i = 0; i < count && total > cache->budget; i++) {
+            if (unlinkat(dirfd(dir), files[i].name, 0) == 0) {
+                total -= files[i].size;
+            }
+        }
+    }
+
+    free(files);
+    closedir(dir);
+}
+
+void cache_store(
+    cache*                  cache,
+    const char*             url,
+    const uint8_t*          data,
+    size_t                  size,
+    const cache_validators* validators
+) {
+    cache_header header = {
+        .expires      = validators->expires,
+        .url_len      = strlen(url),
+        .etag_len     = strlen(validators->etag),
+        .modified_len = strlen(validators->modified),
+        .size         = size,
+    };
+
+    memcpy(header.magic, cache_magic, sizeof cache_magic);
+
+    size_t total = sizeof header + header.url_len + header.etag_len +
+                   header.modified_len + size;
+
+    // too large to ever fit
+    if (total > cache->budget) return;
+
+    // unique per process, so concurrent runs never write the same file
+    char suffix[32];
+    snprintf(suffix, sizeof suffix, ".%ld", (long) getpid());
+
+    char* path = cache_path(cache, url, "");
+    char* temp = cache_path(cache, url, suffix);
+
+    if (!path || !temp) {
+        free(path);
+        free(temp);
+        return;
+    }
+
+    // written next to the entry and moved over it, so readers never see a
+    // partial file
+    int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd >= 0) {
+        const cache_validators* v = validators;
+
+        bool written = write_all(fd, &header, sizeof header) &&
+                       write_all(fd, url, header.url_len) &&
+                       write_all(fd, v->etag, header.etag_len) &&
+                       write_all(fd, v->modified, header.modified_len) &&
+                       write_all(fd, data, size);
+
+        if (close(fd) != 0) written = false;
+
+        if (!written || rename(temp, path) != 0) unlink(temp);
+    }
+
+    free(path);
+    free(temp);
+
+    cache_evict(cache);
+}
+
+void cache_touch(cache* cache, const char* url, time_t expires) {
+    char* path = cache_path(cache, url, "");
+    if (!path) return;
+
+    int fd = open(path, O_RDWR);
+
+    if (fd < 0) {
+        free(path);
+        return;
+    }
+
+    int64_t value = expires;
+    ssize_t wrote =
+        pwrite(fd, &value, sizeof value, offsetof(cache_header, expires));
+
+    // an entry with a torn expiry cannot be trusted, it is fetched again
+    if (wrote == sizeof value) {
+        futimens(fd, NULL);
+    } else {
+        unlink(path);
+    }
+
+    close(fd);
+    free(path);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Downloaded files kept on disk between runs, one file per URL named after
+// its hash. The least recently used files are removed once the total size
+// goes over the budget.
+typedef struct cache cache;
+
+// How long a response without `max-age` is used before revalidating it.
+#define CACHE_FRESH (24 * 60 * 60)
+
+// What a cached response is revalidated with, empty strings when the
+// server sent none.
+typedef struct cache_validators {
+    char   etag[256];
+    char   modified[64];
+    time_t expires;
+} cache_validators;
+
+// Cached response, `data` points into a read-only mapping of the file.
+typedef struct cache_entry {
+    const uint8_t* data;
+    size_t         size;
+
+    void*  map;
+    size_t map_size;
+
+    cache_validators validators;
+
+    // not expired, can be used without asking the server
+    bool fresh;
+} cache_entry;
+
+// Open the cache in `$XDG_CACHE_HOME/asciify` or `~/.cache/asciify`,
+// creating it if needed. Returns `NULL` if there is no usable directory.
+cache* cache_open(size_t budget);
+void   cache_close(cache* cache);
+
+// Map the entry for `url`, fails if there is none.
+bool cache_lookup(cache* cache, const char* url, cache_entry* entry);
+void cache_release(cache_entry* entry);
+
+// Store `data` as the entry for `url`, replacing any older one.
+void cache_store(
+    cache*                  cache,
+    const char*             url,
+    const uint8_t*          data,
+    size_t                  size,
+    const cache_validators* validators
+);
+
+// Mark the entry for `url` as used and valid until `expires`, after the
+// server said it is unchanged.
+void cache_touch(cache* cache, const char* url, time_t expires);
@@ -0,0 +1,177 @@
+#include "convert.h"
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb/stb_image_resize.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "decode.h"
+
+// Fill in the output size missing from `opts` for an image of `width` by
+// `height` pixels.
+static void convert_size(
+    render_opts* opts,
+    int          width,
+    int          height,
+    int          fit_width,
+    int          fit_height
+) {
+    float aspect = (float) width / (float) height * 2.0;
+
+    if (!opts->width && !opts->height) {
+        if ((float) fit_width / aspect > (float) fit_height) {
+            opts->width  = (int) floorf((float) fit_height * aspect);
+            opts->height = fit_height;
+        } else {
+            opts->width  = fit_width;
+            opts->height = (int) floorf((float) fit_width / aspect);
+        }
+    }
+
+    if (!opts->width) {
+        opts->width = (int) floorf((float) opts->height * aspect);
+    }
+
+    if (!opts->height) {
+        opts->height = (int) floorf((float) opts->width / aspect);
+    }
+}
+
+uint8_t* convert_scale(
+    const uint8_t* data,
+    size_t         size,
+    render_opts*   opts,
+    int            fit_width,
+    int            fit_height
+) {
+    int width, height;
+
+    if (!decode_info(data, size, &width, &height)) return NULL;
+
+    convert_size(opts, width, height, fit_width, fit_height);
+
+    int pixel_width, pixel_height;
+    render_pixels(opts, &pixel_width, &pixel_height);
+
+    uint8_t* image = decode_image(
+        data,
+        size,
+        pixel_width,
+        pixel_height,
+        &width,
+        &height
+    );
+
+    if (!image) return NULL;
+
+    uint8_t* scaled = malloc((size_t) pixel_width * pixel_height * 4);
+
+    stbir_resize_uint8(
+        image,
+        width,
+        height,
+        width * 4,
+        scaled,
+        pixel_width,
+        pixel_height,
+        pixel_width * 4,
+        4
+    );
+
+    decode_free(image);
+
+    return scaled;
+}
+
+bool convert_image(
+    frame*         frame,
+    const uint8_t* data,
+    size_t         size,
+    render_opts    opts,
+    int            fit_width,
+    int            fit_height,
+    pool*          pool
+) {
+    uint8_t* scaled = convert_scale(data, size, &opts, fit_width, fit_height);
+
+    if (!scaled) return false;
+
+    render(frame, scaled, &opts, pool);
+
+    free(scaled);
+
+    return true;
+}
+
+bool convert_animation(
+    animation*     animation,
+    const uint8_t* data,
+    size_t         size,
+    render_opts    opts,
+    int            fit_width,
+    int            fit_height
+) {
+    *animation = (struct animation) {0};
+
+    int         width, height, delay;
+    decode_gif* gif = decode_gif_open(data, size, &width, &height);
+
+    if (!gif) return false;
+
+    // only the first two frames are decoded, to tell it is animated
+    bool animated =
+        decode_gif_next(gif, &delay) && decode_gif_next(gif, &delay);
+
+    decode_gif_close(gif);
+
+    if (!animated) return false;
+
+    // the encoded image is freed once it is prepared, but is decoded again
+    // while the animation plays
+    uint8_t* copy = malloc(size);
+
+    if (!copy) return false;
+
+    memcpy(copy, data, size);
+
+    convert_size(&opts, width, height, fit_width, fit_height);
+
+    *animation = (struct animation) {
+        .opts = opts,
+        .data = copy,
+        .size = size,
+    };
+
+    return true;
+}
+
+void animation_scale(
+    const animation* animation,
+    const uint8_t*   frame,
+    int              width,
+    int              height,
+    uint8_t*         scaled
+) {
+    int pixel_width, pixel_height;
+    render_pixels(&animation->opts, &pixel_width, &pixel_height);
+
+    stbir_resize_uint8(
+        frame,
+        width,
+        height,
+        width * 4,
+        scaled,
+        pixel_width,
+        pixel_height,
+        pixel_width * 4,
+        4
+    );
+}
+
+void animation_free(animation* animation) {
+    free(animation->data);
+
+    *animation = (struct animation) {0};
+}
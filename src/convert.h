@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "pool.h"
+#include "render.h"
+
+// Decode the image in `data` and scale it to the output size, filling in the
+// size missing from `opts` like `convert_image`. Returns `NULL` on failure,
+// free the result with `free`.
+uint8_t* convert_scale(
+    const uint8_t* data,
+    size_t         size,
+    render_opts*   opts,
+    int            fit_width,
+    int            fit_height
+);
+
+// Decode the image in `data`, scale it and render it into `frame`. A width
+// or height of 0 in `opts` follows the aspect ratio of the image, with both
+// 0 the image is fit into `fit_width` by `fit_height`.
+bool convert_image(
+    frame*         frame,
+    const uint8_t* data,
+    size_t         size,
+    render_opts    opts,
+    int            fit_width,
+    int            fit_height,
+    pool*          pool
+);
+
+// An animated GIF to play, its frames are decoded and scaled as they are
+// shown, so a long one takes no more memory than a short one.
+typedef struct animation {
+    // with the output size
+    render_opts opts;
+
+    // a copy of the encoded GIF, `NULL` if there is no animation
+    uint8_t* data;
+    size_t   size;
+} animation;
+
+// Check that `data` is an animated GIF and size it like `convert_image`.
+// Fails if `data` is not an animated GIF.
+bool convert_animation(
+    animation*     animation,
+    const uint8_t* data,
+    size_t         size,
+    render_opts    opts,
+    int            fit_width,
+    int            fit_height
+);
+
+// Scale a decoded `width` by `height` frame of `animation` into `scaled`, in
+// pixels as given by `render_pixels`.
+void animation_scale(
+    const animation* animation,
+    const uint8_t*   frame,
+    int              width,
+    int              height,
+    uint8_t*         scaled
+);
+
+void animation_free(animation* animation);
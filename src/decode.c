@@ -0,0 +1,252 @@
+#include "decode.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <jpeglib.h>
+
+typedef struct jpeg_error {
+    struct jpeg_error_mgr mgr;
+    jmp_buf               jump;
+} jpeg_error;
+
+static void jpeg_error_exit(j_common_ptr info) {
+    jpeg_error* error = (jpeg_error*) info->err;
+    longjmp(error->jump, 1);
+}
+
+// warnings would end up in the middle of the image
+static void jpeg_output_message(j_common_ptr info) {
+    (void) info;
+}
+
+static bool is_jpeg(const uint8_t* data, size_t size) {
+    return size >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff;
+}
+
+// Largest of the DCT scale denominators 8, 4 and 2 that keeps the image at
+// least `min_width` by `min_height`, or 1.
+static int jpeg_scale(int width, int height, int min_width, int min_height) {
+    int denom = 8;
+
+    while (denom > 1 && ((width + denom - 1) / denom < min_width ||
+                         (height + denom - 1) / denom < min_height)) {
+        denom /= 2;
+    }
+
+    return denom;
+}
+
+static uint8_t* decode_jpeg(
+    const uint8_t* data,
+    size_t         size,
+    int            min_width,
+    int            min_height,
+    int*           width,
+    int*           height
+) {
+    struct jpeg_decompress_struct info;
+    jpeg_error                    error;
+
+    // modified between `setjmp` and `longjmp`
+    uint8_t* volatile pixels = NULL;
+
+    info.err                    = jpeg_std_error(&error.mgr);
+    error.mgr.error_exit        = jpeg_error_exit;
+    error.mgr.output_message    = jpeg_output_message;
+
+    if (setjmp(error.jump)) {
+        jpeg_destroy_decompress(&info);
+        free(pixels);
+        return NULL;
+    }
+
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, data, size);
+    jpeg_read_header(&info, TRUE);
+
+    // libjpeg can't convert these to RGB, leave them to stb
+    if (info.jpeg_color_space == JCS_CMYK ||
+        info.jpeg_color_space == JCS_YCCK) {
+        jpeg_destroy_decompress(&info);
+        return NULL;
+    }
+
+    info.out_color_space = JCS_EXT_RGBA;
+    info.scale_num       = 1;
+    info.scale_denom     = jpeg_scale(
+        info.image_width,
+        info.image_height,
+        min_width,
+        min_height
+    );
+
+    jpeg_start_decompress(&info);
+
+    size_t stride = (size_t) info.output_width * 4;
+    pixels        = malloc(stride * info.output_height);
+
+    if (!pixels) {
+        jpeg_destroy_decompress(&info);
+        return NULL;
+    }
+
+    while (info.output_scanline < info.output_height) {
+        JSAMPROW row = pixels + info.output_scanline * stride;
+        jpeg_read_scanlines(&info, &row, 1);
+    }
+
+    *width  = info.output_width;
+    *height = info.output_height;
+
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+
+    return pixels;
+}
+
+bool decode_info(const uint8_t* data, size_t size, int* width, int* height) {
+    int channels;
+    return stbi_info_from_memory(data, size, width, height, &channels);
+}
+
+// how far from the end the end marker is looked for, some encoders pad
+#define TAIL_SIZE 1024
+
+// Whether `marker` is in the last `TAIL_SIZE` bytes of `data`.
+static bool has_tail(
+    const uint8_t* data,
+    size_t         size,
+    const char*    marker,
+    size_t         len
+) {
+    size_t start = size > TAIL_SIZE ? size - TAIL_SIZE : 0;
+
+    for (size_t i = size; i >= start + len; i--) {
+        if (memcmp(data + i - len, marker, len) == 0) return true;
+    }
+
+    return false;
+}
+
+bool decode_probe(const uint8_t* data, size_t size) {
+    int width, height;
+
+    if (!decode_info(data, size, &width, &height)) return false;
+
+    if (is_jpeg(data, size)) return has_tail(data, size, "\xff\xd9", 2);
+
+    if (size >= 8 && memcmp(data, "\x89PNG", 4) == 0) {
+        return has_tail(data, size, "IEND", 4);
+    }
+
+    if (size >= 6 && memcmp(data, "GIF8", 4) == 0) {
+        return has_tail(data, size, "\x00;", 2);
+    }
+
+    return true;
+}
+
+uint8_t* decode_image(
+    const uint8_t* data,
+    size_t         size,
+    int            min_width,
+    int            min_height,
+    int*           width,
+    int*           height
+) {
+    if (is_jpeg(data, size)) {
+        uint8_t* pixels =
+            decode_jpeg(data, size, min_width, min_height, width, height);
+
+        if (pixels) return pixels;
+    }
+
+    int channels;
+    return stbi_load_from_memory(data, size, width, height, &channels, 4);
+}
+
+struct decode_gif {
+    stbi__context context;
+    stbi__gif     gif;
+
+    // copies of the last two frames, frame `n` is in `previous[n % 2]`, for
+    // the disposal that restores the frame two back
+    uint8_t* previous[2];
+    size_t   frame_size;
+    int      decoded;
+};
+
+decode_gif* decode_gif_open(
+    const uint8_t* data,
+    size_t         size,
+    int*           width,
+    int*           height
+) {
+    if (size < 6 || memcmp(data, "GIF8", 4) != 0) return NULL;
+    if (!decode_info(data, size, width, height)) return NULL;
+
+    decode_gif* gif = calloc(1, sizeof(decode_gif));
+
+    if (!gif) return NULL;
+
+    gif->frame_size  = (size_t) *width * *height * 4;
+    gif->previous[0] = malloc(gif->frame_size);
+    gif->previous[1] = malloc(gif->frame_size);
+
+    if (!gif->previous[0] || !gif->previous[1]) {
+        decode_gif_close(gif);
+        return NULL;
+    }
+
+    stbi__start_mem(&gif->context, data, (int) size);
+
+    return gif;
+}
+
+const uint8_t* decode_gif_next(decode_gif* gif, int* delay) {
+    uint8_t* two_back = NULL;
+    uint8_t* copy     = gif->previous[gif->decoded % 2];
+
+    if (gif->decoded >= 2) two_back = copy;
+
+    int      channels;
+    uint8_t* pixels = stbi__gif_load_next(
+        &gif->context,
+        &gif->gif,
+        &channels,
+        4,
+        two_back
+    );
+
+    // the context itself is returned at the end of the stream
+    if (!pixels || pixels == (uint8_t*) &gif->context) return NULL;
+
+    memcpy(copy, pixels, gif->frame_size);
+    gif->decoded++;
+
+    *delay = gif->gif.delay;
+
+    return copy;
+}
+
+void decode_gif_close(decode_gif* gif) {
+    if (!gif) return;
+
+    STBI_FREE(gif->gif.out);
+    STBI_FREE(gif->gif.history);
+    STBI_FREE(gif->gif.background);
+
+    free(gif->previous[0]);
+    free(gif->previous[1]);
+    free(gif);
+}
+
+void decode_free(uint8_t* image) {
+    stbi_image_free(image);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Read the dimensions of the encoded image in `data`.
+bool decode_info(const uint8_t* data, size_t size, int* width, int* height);
+
+// Check that `data` is a whole image without decoding it: the header must
+// parse, and JPEG, PNG and GIF must have their end marker, which a truncated
+// download lacks.
+bool decode_probe(const uint8_t* data, size_t size);
+
+// Decode `data` to RGBA. JPEGs are scaled down while decoding by the
+// largest power of two that keeps them at least `min_width` by
+// `min_height`, other formats are decoded at full size. Returns `NULL` on
+// failure, free the result with `decode_free`.
+uint8_t* decode_image(
+    const uint8_t* data,
+    size_t         size,
+    int            min_width,
+    int            min_height,
+    int*           width,
+    int*           height
+);
+
+// Frames of a GIF decoded one at a time, so only the frame being composed
+// and the two before it are held however long the animation is.
+typedef struct decode_gif decode_gif;
+
+// Start decoding the GIF in `data`, which must outlive the decoder. Returns
+// `NULL` if `data` is not a GIF.
+decode_gif* decode_gif_open(
+    const uint8_t* data,
+    size_t         size,
+    int*           width,
+    int*           height
+);
+
+// Decode the next frame to RGBA, valid until the next call. `delay` gets how
+// long it is shown in milliseconds. Returns `NULL` after the last frame or on
+// failure.
+const uint8_t* decode_gif_next(decode_gif* gif, int* delay);
+
+void decode_gif_close(decode_gif* gif);
+
+void decode_free(uint8_t* image);
@@ -0,0 +1,44 @@
+#include "dither.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const uint8_t dither_bayer[8][8] = {
+    {0, 32, 8, 40, 2, 34, 10, 42},
+    {48, 16, 56, 24, 50, 18, 58, 26},
+    {12, 44, 4, 36, 14, 46, 6, 38},
+    {60, 28, 52, 20, 62, 30, 54, 22},
+    {3, 35, 11, 43, 1, 33, 9, 41},
+    {51, 19, 59, 27, 49, 17, 57, 25},
+    {15, 47, 7, 39, 13, 45, 5, 37},
+    {63, 31, 55, 23, 61, 29, 53, 21},
+};
+
+void diffuser_init(diffuser* diffuser, int width, int channels) {
+    size_t size = (size_t) (width + 2) * channels;
+
+    *diffuser = (struct diffuser) {
+        .current  = calloc(size, sizeof(int32_t)),
+        .next     = calloc(size, sizeof(int32_t)),
+        .width    = width,
+        .channels = channels,
+    };
+}
+
+void diffuser_free(diffuser* diffuser) {
+    free(diffuser->current);
+    free(diffuser->next);
+
+    *diffuser = (struct diffuser) {0};
+}
+
+void diffuser_next(diffuser* diffuser) {
+    int32_t* done = diffuser->current;
+
+    diffuser->current = diffuser->next;
+    diffuser->next    = done;
+
+    size_t size = (size_t) (diffuser->width + 2) * diffuser->channels;
+
+    memset(diffuser->next, 0, size * sizeof(int32_t));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+
+// How values between the levels they are quantized to are spread out.
+typedef enum dither_mode {
+    DITHER_NONE    = 0,
+    // an 8x8 Bayer matrix, every pixel on its own
+    DITHER_ORDERED = 1,
+    // Floyd-Steinberg, carrying the error along and down the rows
+    DITHER_DIFFUSE = 2,
+} dither_mode;
+
+// Number of thresholds in the Bayer matrix.
+#define DITHER_LEVELS 64
+
+extern const uint8_t dither_bayer[8][8];
+
+// Threshold in `0..DITHER_LEVELS` of the pixel at `x`, `y`.
+static inline int dither_threshold(int x, int y) {
+    return dither_bayer[y & 7][x & 7];
+}
+
+// Error of a row of pixels being carried to the rest of the row and the one
+// below, `channels` values per pixel. Only two rows are kept, so an image is
+// diffused as it is rendered.
+typedef struct diffuser {
+    // padded by a pixel on both sides
+    int32_t* current;
+    int32_t* next;
+
+    int width;
+    int channels;
+} diffuser;
+
+void diffuser_init(diffuser* diffuser, int width, int channels);
+void diffuser_free(diffuser* diffuser);
+
+// Move on to the row below.
+void diffuser_next(diffuser* diffuser);
+
+// Error carried to channel `c` of pixel `x` of the current row.
+static inline int32_t diffuser_error(const diffuser* diffuser, int x, int c) {
+    return diffuser->current[(x + 1) * diffuser->channels + c];
+}
+
+// Spread the `error` left after quantizing channel `c` of pixel `x` with
+// the Floyd-Steinberg weights.
+static inline void diffuser_spread(
+    diffuser* diffuser,
+    int       x,
+    int       c,
+    int32_t   error
+) {
+    int      n       = diffuser->channels;
+    int32_t* current = diffuser->current + (x + 1) * n + c;
+    int32_t* next    = diffuser->next + (x + 1) * n + c;
+
+    int32_t right = error * 7 / 16;
+    int32_t left  = error * 3 / 16;
+    int32_t below = error * 5 / 16;
+
+    current[n] += right;
+    next[-n]   += left;
+    next[0]    += below;
+
+    // the rest, so no error is lost to rounding
+    next[n] += error - right - left - below;
+}
@@ -1,11 +1,60 @@
 #include "download.h"
 
-#include <curl/curl.h>
+#include <ctype.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 
 void free_image_data(image_data* data) {
-    free(data->data);
+    if (data->map) {
+        munmap(data->map, data->map_size);
+    } else {
+        free(data->data);
+    }
+}
+
+typedef struct image_download {
+    image_data* image;
+    CURL*       curl;
+    size_t      max_size;
+
+    cache*      cache;
+    const char* url;
+
+    // earlier response the transfer revalidates
+    cache_entry        cached;
+    struct curl_slist* headers;
+
+    // caching headers of the response
+    cache_validators validators;
+    long             max_age;
+    bool             no_store;
+} image_download;
+
+// Grow `image` to hold at least `capacity` bytes.
+static bool image_reserve(image_data* image, size_t capacity) {
+    if (capacity <= image->capacity) return true;
+
+    uint8_t* data = realloc(image->data, capacity);
+    if (!data) return false;
+
+    image->data     = data;
+    image->capacity = capacity;
+
+    return true;
+}
+
+// Hand the mapping of `entry` over to `image`.
+static void image_from_cache(image_data* image, cache_entry* entry) {
+    *image = (image_data) {
+        .size     = entry->size,
+        .data     = (uint8_t*) entry->data,
+        .map      = entry->map,
+        .map_size = entry->map_size,
+    };
+
+    *entry = (cache_entry) {0};
 }
 
 static size_t image_write_callback(
@@ -14,9 +63,34 @@ static size_t image_write_callback(
     size_t nmemb,
     void*  user_data
 ) {
-    size_t      total = size * nmemb;
-    image_data* image = user_data;
-    image->data       = realloc(image->data, image->size + total);
+    size_t          total    = size * nmemb;
+    image_download* download = user_data;
+    image_data*     image    = download->image;
+
+    if (download->max_size && image->size + total > download->max_size) {
+        return 0;
+    }
+
+    if (!image->data) {
+        curl_off_t length = -1;
+        curl_easy_getinfo(
+            download->curl,
+            CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+            &length
+        );
+
+        if (length > 0 && (!download->max_size ||
+                           (curl_off_t) download->max_size >= length)) {
+            image_reserve(image, length);
+        }
+    }
+
+    if (image->size + total > image->capacity) {
+        size_t capacity = image->capacity ? image->capacity * 2 : 64 * 1024;
+        if (capacity < image->size + total) capacity = image->size + total;
+
+        if (!image_reserve(image, capacity)) return 0;
+    }
 
     memcpy(image->data + image->size, contents, total);
 
@@ -25,24 +99,510 @@ static size_t image_write_callback(
     return total;
 }
 
-bool download_image(image_data* data, const char* url) {
-    *data = (image_data) {0};
+// Copy the value of the header in `line` to `value` if it is called `name`,
+// which has to be lowercase. Values that do not fit are left empty.
+static bool header_value(
+    const char* line,
+    size_t      len,
+    const char* name,
+    char*       value,
+    size_t      value_size
+) {
+    size_t name_len = strlen(name);
+
+    if (len <= name_len || line[name_len] != ':') return false;
+
+    for (size_t i = 0; i < name_len; i++) {
+        if (tolower((unsigned char) line[i]) != name[i]) return false;
+    }
+
+    const char* start = line + name_len + 1;
+    const char* end   = line + len;
+
+    while (start < end && isspace((unsigned char) *start)) start++;
+    while (end > start && isspace((unsigned char) end[-1])) end--;
+
+    size_t n = end - start;
+    if (n >= value_size) n = 0;
+
+    memcpy(value, start, n);
+    value[n] = '\0';
 
-    CURL* curl = curl_easy_init();
+    return true;
+}
+
+static size_t image_header_callback(
+    char*  buffer,
+    size_t size,
+    size_t nitems,
+    void*  user_data
+) {
+    size_t            total      = size * nitems;
+    image_download*   download   = user_data;
+    cache_validators* validators = &download->validators;
+
+    // every response of a redirect starts with a status line
+    if (total >= 5 && memcmp(buffer, "HTTP/", 5) == 0) {
+        *validators        = (cache_validators) {0};
+        download->max_age  = -1;
+        download->no_store = false;
+
+        return total;
+    }
+
+    char control[256];
+
+    header_value(
+        buffer,
+        total,
+        "etag",
+        validators->etag,
+        sizeof validators->etag
+    );
+    header_value(
+        buffer,
+        total,
+        "last-modified",
+        validators->modified,
+        sizeof validators->modified
+    );
+
+    if (header_value(buffer, total, "cache-control", control, sizeof control)) {
+        for (char* c = control; *c; c++) *c = tolower((unsigned char) *c);
+
+        char* max_age = strstr(control, "max-age=");
 
-    if (!curl) return false;
+        if (max_age) download->max_age = strtol(max_age + 8, NULL, 10);
+        if (strstr(control, "no-cache")) download->max_age = 0;
+        if (strstr(control, "no-store")) download->no_store = true;
+    }
+
+    return total;
+}
+
+// Ask the server to only send the image if it changed since `validators`.
+static struct curl_slist* conditional_headers(
+    const cache_validators* validators
+) {
+    struct curl_slist* headers = NULL;
+    char               header[sizeof validators->etag + 32];
+
+    if (*validators->etag) {
+        snprintf(header, sizeof header, "If-None-Match: %s", validators->etag);
+        headers = curl_slist_append(headers, header);
+    }
+
+    if (*validators->modified) {
+        snprintf(
+            header,
+            sizeof header,
+            "If-Modified-Since: %s",
+            validators->modified
+        );
+        headers = curl_slist_append(headers, header);
+    }
+
+    return headers;
+}
+
+// Set up `curl` to download `url` into `image`. Returns false if a fresh
+// cache entry already filled in `image` and there is nothing to transfer.
+static bool download_setup(
+    image_download* download,
+    cache*          cache,
+    CURL*           curl,
+    image_data*     image,
+    const char*     url,
+    size_t          max_size
+) {
+    *image    = (image_data) {0};
+    *download = (image_download) {
+        .image    = image,
+        .curl     = curl,
+        .max_size = max_size,
+        .cache    = cache,
+        .url      = url,
+        .max_age  = -1,
+    };
+
+    if (cache && cache_lookup(cache, url, &download->cached)) {
+        if (download->cached.fresh) {
+            image_from_cache(image, &download->cached);
+            return false;
+        }
+
+        download->headers = conditional_headers(&download->cached.validators);
+    }
 
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, image_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, data);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, download);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, image_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, download);
+    curl_easy_setopt(curl, CURLOPT_MAXFILESIZE_LARGE, (curl_off_t) max_size);
+
+    if (download->headers) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, download->headers);
+    }
+
+    return true;
+}
+
+static time_t download_expires(const image_download* download) {
+    long max_age = download->max_age >= 0 ? download->max_age : CACHE_FRESH;
+
+    return time(NULL) + max_age;
+}
+
+// Drop what the transfer still holds on to.
+static void download_cancel(image_download* download) {
+    curl_slist_free_all(download->headers);
+    cache_release(&download->cached);
+
+    download->headers = NULL;
+}
+
+// Finish the transfer, falling back to the cached image if the server says
+// it did not change. The image is left empty on failure.
+static bool download_finish(image_download* download, CURLcode result) {
+    long status = 0;
+    curl_easy_getinfo(download->curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (result == CURLE_OK && status == 304 && download->cached.map) {
+        cache_touch(download->cache, download->url, download_expires(download));
+
+        free_image_data(download->image);
+        image_from_cache(download->image, &download->cached);
+    }
+
+    download_cancel(download);
+
+    if (result != CURLE_OK) {
+        free_image_data(download->image);
+        *download->image = (image_data) {0};
+
+        return false;
+    }
+
+    return true;
+}
+
+// Keep a newly downloaded image in the cache.
+static void download_store(image_download* download) {
+    if (!download->cache || download->image->map || download->no_store) {
+        return;
+    }
+
+    long status = 0;
+    curl_easy_getinfo(download->curl, CURLINFO_RESPONSE_CODE, &status);
+
+    if (status != 200) return;
+
+    download->validators.expires = download_expires(download);
+
+    cache_store(
+        download->cache,
+        download->url,
+        download->image->data,
+        download->image->size,
+        &download->validators
+    );
+}
+
+bool download_image(
+    net*        net,
+    cache*      cache,
+    image_data* data,
+    const char* url,
+    size_t      max_size
+) {
+    CURL* curl = net_easy(net);
+
+    image_download download;
+
+    if (!download_setup(&download, cache, curl, data, url, max_size)) {
+        return true;
+    }
 
     CURLcode status = curl_easy_perform(curl);
 
-    curl_easy_cleanup(curl);
+    if (!download_finish(&download, status)) return false;
+
+    download_store(&download);
+
+    return true;
+}
+
+// Transfer slot of `download_first`.
+typedef struct candidate {
+    CURL*          curl;
+    image_data     image;
+    image_download download;
+    bool           active;
+} candidate;
+
+// URLs `download_first` works through.
+typedef struct download_race {
+    net*           net;
+    cache*         cache;
+    CURLM*         multi;
+    char**         urls;
+    size_t         url_count;
+    size_t         next;
+    size_t         max_size;
+    download_check check;
+} download_race;
+
+// Start the next URL on `candidate`. Returns true if it was cached and
+// passed the check right away instead.
+static bool candidate_next(download_race* race, candidate* candidate) {
+    while (race->next < race->url_count) {
+        const char* url = race->urls[race->next++];
+
+        curl_easy_reset(candidate->curl);
+        net_share(race->net, candidate->curl);
+
+        bool transfer = download_setup(
+            &candidate->download,
+            race->cache,
+            candidate->curl,
+            &candidate->image,
+            url,
+            race->max_size
+        );
+
+        if (transfer) {
+            curl_easy_setopt(candidate->curl, CURLOPT_PRIVATE, candidate);
+            curl_multi_add_handle(race->multi, candidate->curl);
+            candidate->active = true;
+
+            return false;
+        }
+
+        if (race->check(&candidate->image)) return true;
+
+        free_image_data(&candidate->image);
+        candidate->image = (image_data) {0};
+    }
+
+    return false;
+}
+
+bool download_first(
+    net*           net,
+    cache*         cache,
+    image_data*    data,
+    char**         urls,
+    size_t         url_count,
+    size_t         parallel,
+    size_t         max_size,
+    download_check check
+) {
+    *data = (image_data) {0};
+
+    if (parallel == 0) parallel = 1;
+    if (parallel > url_count) parallel = url_count;
+
+    CURLM*     multi      = curl_multi_init();
+    candidate* candidates = calloc(parallel, sizeof *candidates);
+
+    if (!multi || !candidates) {
+        if (multi) curl_multi_cleanup(multi);
+        free(candidates);
+        return false;
+    }
+
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long) parallel);
+
+    download_race race = {
+        .net       = net,
+        .cache     = cache,
+        .multi     = multi,
+        .urls      = urls,
+        .url_count = url_count,
+        .max_size  = max_size,
+        .check     = check,
+    };
+
+    candidate* winner = NULL;
+
+    for (size_t i = 0; i < parallel && !winner; i++) {
+        candidates[i].curl = curl_easy_init();
+        if (!candidates[i].curl) continue;
+
+        if (candidate_next(&race, &candidates[i])) winner = &candidates[i];
+    }
+
+    int running = 1;
 
-    return status == CURLE_OK;
+    while (!winner && running) {
+        curl_multi_perform(multi, &running);
+
+        CURLMsg* msg;
+        int      left;
+
+        while (!winner && (msg = curl_multi_info_read(multi, &left))) {
+            if (msg->msg != CURLMSG_DONE) continue;
+
+            candidate* candidate;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &candidate);
+
+            CURLcode result = msg->data.result;
+
+            curl_multi_remove_handle(multi, candidate->curl);
+            candidate->active = false;
+
+            if (download_finish(&candidate->download, result) &&
+                check(&candidate->image)) {
+                download_store(&candidate->download);
+                winner = candidate;
+                break;
+            }
+
+            free_image_data(&candidate->image);
+            candidate->image = (image_data) {0};
+
+            if (candidate_next(&race, candidate)) {
+                winner = candidate;
+                break;
+            }
+
+            if (candidate->active) running = 1;
+        }
+
+        if (!winner && running) curl_multi_poll(multi, NULL, 0, 1000, NULL);
+    }
+
+    if (winner) {
+        *data         = winner->image;
+        winner->image = (image_data) {0};
+    }
+
+    // cancel whatever is still in flight
+    for (size_t i = 0; i < parallel; i++) {
+        if (candidates[i].active) {
+            curl_multi_remove_handle(multi, candidates[i].curl);
+        }
+
+        download_cancel(&candidates[i].download);
+
+        if (candidates[i].curl) curl_easy_cleanup(candidates[i].curl);
+        free_image_data(&candidates[i].image);
+    }
+
+    free(candidates);
+    curl_multi_cleanup(multi);
+
+    return winner != NULL;
+}
+
+// Start of the thumbnail URLs in the search results, the URL runs up to
+// the next `"`.
+static const char search_needle[] = "<img class=\"DS1iW\" alt=\"\" src=\"";
+
+#define SEARCH_NEEDLE_LEN (sizeof(search_needle) - 1)
+
+// Pulls URLs out of the search response as it arrives. Matches and URLs may
+// be split across chunks, so the scan state is kept between them.
+typedef struct search_scan {
+    char** urls;
+    size_t url_count;
+    size_t max_urls;
+
+    // length of the needle prefix matched so far
+    size_t matched;
+
+    // URL being read, valid once the whole needle matched
+    char*  url;
+    size_t url_len;
+    size_t url_cap;
+
+    bool failed;
+} search_scan;
+
+static bool search_url_append(
+    search_scan* scan,
+    const char*  data,
+    size_t       len
+) {
+    if (scan->url_len + len + 1 > scan->url_cap) {
+        size_t capacity = scan->url_cap ? scan->url_cap * 2 : 256;
+        while (capacity < scan->url_len + len + 1) capacity *= 2;
+
+        char* url = realloc(scan->url, capacity);
+        if (!url) return false;
+
+        scan->url     = url;
+        scan->url_cap = capacity;
+    }
+
+    memcpy(scan->url + scan->url_len, data, len);
+    scan->url_len += len;
+
+    return true;
+}
+
+static bool search_url_finish(search_scan* scan) {
+    char** urls = realloc(scan->urls, (scan->url_count + 1) * sizeof *urls);
+    if (!urls) return false;
+
+    scan->url[scan->url_len] = '\0';
+
+    urls[scan->url_count++] = scan->url;
+    scan->urls              = urls;
+
+    scan->url     = NULL;
+    scan->url_len = 0;
+    scan->url_cap = 0;
+    scan->matched = 0;
+
+    return true;
+}
+
+static bool search_scan_chunk(
+    search_scan* scan,
+    const char*  data,
+    size_t       len
+) {
+    const char* end = data + len;
+
+    while (data < end) {
+        if (scan->matched == SEARCH_NEEDLE_LEN) {
+            const char* quote = memchr(data, '"', end - data);
+            size_t      n     = (quote ? quote : end) - data;
+
+            if (!search_url_append(scan, data, n)) return false;
+
+            data += n;
+
+            if (!quote) break;
+
+            data += 1;
+
+            if (!search_url_finish(scan)) return false;
+            continue;
+        }
+
+        // `<` only starts the needle, so a mismatch can always restart
+        if (scan->matched == 0) {
+            const char* open = memchr(data, '<', end - data);
+            if (!open) break;
+
+            data          = open + 1;
+            scan->matched = 1;
+            continue;
+        }
+
+        if (*data == search_needle[scan->matched]) {
+            scan->matched += 1;
+        } else {
+            scan->matched = *data == '<';
+        }
+
+        data += 1;
+    }
+
+    return true;
 }
 
 static size_t search_write_callback(
@@ -51,30 +611,32 @@ static size_t search_write_callback(
     size_t nmemb,
     void*  user_data
 ) {
-    size_t total    = size * nmemb;
-    char** response = user_data;
-    *response       = realloc(*response, strlen(*response) + total + 1);
+    size_t       total = size * nmemb;
+    search_scan* scan  = user_data;
 
-    strncat(*response, contents, total);
+    if (!search_scan_chunk(scan, contents, total)) {
+        scan->failed = true;
+        return 0;
+    }
+
+    // enough candidates, stop the transfer
+    if (scan->max_urls && scan->url_count >= scan->max_urls) return 0;
 
     return total;
 }
 
 bool search_images(
+    net*        net,
     size_t*     url_count,
     char***     urls,
+    size_t      max_urls,
     int         offset,
     const char* search_term
 ) {
-    CURL* curl = curl_easy_init();
-    if (!curl) return false;
-
+    CURL* curl    = net_easy(net);
     char* escaped = curl_easy_escape(curl, search_term, 0);
 
-    if (!escaped) {
-        curl_easy_cleanup(curl);
-        return false;
-    }
+    if (!escaped) return false;
 
     size_t len = snprintf(
         NULL,
@@ -96,44 +658,199 @@ bool search_images(
         escaped
     );
 
-    char* response = calloc(1, 1);
+    search_scan scan = {.max_urls = max_urls};
 
     curl_easy_setopt(curl, CURLOPT_URL, url);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, search_write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &scan);
 
     CURLcode result = curl_easy_perform(curl);
 
-    curl_easy_cleanup(curl);
-    free(escaped);
+    curl_free(escaped);
     free(url);
+    free(scan.url);
+
+    // stopping early is reported as a write error
+    bool stopped = result == CURLE_WRITE_ERROR && !scan.failed;
+
+    if ((result != CURLE_OK && !stopped) || scan.url_count == 0) {
+        for (size_t i = 0; i < scan.url_count; i++) free(scan.urls[i]);
+        free(scan.urls);
+
+        return false;
+    }
+
+    *url_count = scan.url_count;
+    *urls      = scan.urls;
+
+    return true;
+}
+
+void search_memo_free(search_memo* memo) {
+    for (size_t i = 0; i < memo->url_count; i++) free(memo->urls[i]);
+
+    free(memo->urls);
+    free(memo->term);
+
+    *memo = (search_memo) {0};
+}
 
-    if (result != CURLE_OK) return false;
+// Key of the results in the on-disk cache.
+static char* search_key(int offset, const char* search_term) {
+    size_t len = snprintf(NULL, 0, "search:%i:%s", offset, search_term);
+    char*  key = malloc(len + 1);
 
-    *url_count = 0;
-    *urls      = NULL;
+    if (key) snprintf(key, len + 1, "search:%i:%s", offset, search_term);
 
-    const char* haystack = response;
-    const char* needle   = "<img class=\"DS1iW\" alt=\"\" src=\"";
-    while ((haystack = strstr(haystack, needle))) {
-        haystack += strlen(needle);
+    return key;
+}
+
+// Split the newline separated URLs of a cache entry.
+static bool search_parse(
+    const cache_entry* entry,
+    size_t*            url_count,
+    char***            urls
+) {
+    const char* data  = (const char*) entry->data;
+    const char* end   = data + entry->size;
+    size_t      count = 0;
+    char**      list  = NULL;
+
+    while (data < end) {
+        const char* newline = memchr(data, '\n', end - data);
+        size_t      len     = (newline ? newline : end) - data;
 
-        char* end = strstr(haystack, "\"");
-        if (!end) return 1;
+        char** grown = realloc(list, (count + 1) * sizeof *list);
+        char*  url   = malloc(len + 1);
 
-        char* url = NULL;
-        url       = malloc(end - haystack + 1);
-        memcpy(url, haystack, end - haystack);
-        url[end - haystack] = '\0';
+        if (grown) list = grown;
 
-        *url_count += 1;
-        *urls                   = realloc(*urls, (sizeof *urls) * *url_count);
-        (*urls)[*url_count - 1] = url;
+        if (!grown || !url) {
+            free(url);
+            for (size_t i = 0; i < count; i++) free(list[i]);
+            free(list);
+
+            return false;
+        }
+
+        memcpy(url, data, len);
+        url[len] = '\0';
+
+        list[count++] = url;
+        data         += len + 1;
     }
 
-    free(response);
+    if (count == 0) return false;
+
+    *url_count = count;
+    *urls      = list;
 
     return true;
 }
+
+static void search_store(
+    cache*      cache,
+    const char* key,
+    char**      urls,
+    size_t      url_count,
+    time_t      expires
+) {
+    size_t size = 0;
+
+    for (size_t i = 0; i < url_count; i++) size += strlen(urls[i]) + 1;
+
+    uint8_t* data = malloc(size);
+    if (!data) return;
+
+    size_t offset = 0;
+
+    for (size_t i = 0; i < url_count; i++) {
+        size_t len = strlen(urls[i]);
+
+        memcpy(data + offset, urls[i], len);
+        data[offset + len] = '\n';
+
+        offset += len + 1;
+    }
+
+    cache_validators validators = {.expires = expires};
+
+    cache_store(cache, key, data, size, &validators);
+
+    free(data);
+}
+
+bool search_images_cached(
+    net*         net,
+    cache*       cache,
+    search_memo* memo,
+    size_t       max_urls,
+    int          offset,
+    const char*  search_term,
+    int          ttl
+) {
+    time_t now = time(NULL);
+
+    bool same = memo->term && memo->offset == offset &&
+                strcmp(memo->term, search_term) == 0;
+
+    if (same && now < memo->expires) return true;
+
+    search_memo_free(memo);
+
+    size_t term_len = strlen(search_term);
+
+    memo->term   = malloc(term_len + 1);
+    memo->offset = offset;
+
+    if (!memo->term) return false;
+
+    memcpy(memo->term, search_term, term_len + 1);
+
+    char* key = cache && ttl > 0 ? search_key(offset, search_term) : NULL;
+
+    cache_entry entry;
+
+    if (key && cache_lookup(cache, key, &entry)) {
+        bool parsed = entry.fresh &&
+                      search_parse(&entry, &memo->url_count, &memo->urls);
+
+        memo->expires = entry.validators.expires;
+        cache_release(&entry);
+
+        if (parsed) {
+            free(key);
+            return true;
+        }
+    }
+
+    bool found = search_images(
+        net,
+        &memo->url_count,
+        &memo->urls,
+        max_urls,
+        offset,
+        search_term
+    );
+
+    if (found) {
+        memo->expires = now + ttl;
+
+        if (key) {
+            search_store(
+                cache,
+                key,
+                memo->urls,
+                memo->url_count,
+                memo->expires
+            );
+        }
+    } else {
+        memo->url_count = 0;
+        memo->urls      = NULL;
+    }
+
+    free(key);
+
+    return found;
+}
@@ -4,17 +4,80 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "cache.h"
+#include "net.h"
+
 typedef struct image_data {
     size_t   size;
+    size_t   capacity;
     uint8_t* data;
+
+    // set when `data` points into a mapped cache file
+    void*  map;
+    size_t map_size;
 } image_data;
 
 void free_image_data(image_data* data);
 
-bool download_image(image_data* data, const char* url);
+// Download `url` into `data`, giving up once it is larger than `max_size`
+// bytes, 0 means no limit. Goes through `cache` unless it is `NULL`.
+// `data` is left empty on failure.
+bool download_image(
+    net*        net,
+    cache*      cache,
+    image_data* data,
+    const char* url,
+    size_t      max_size
+);
+// Tells whether a downloaded image is usable.
+typedef bool (*download_check)(const image_data* data);
+
+// Download up to `parallel` of `urls` at a time, in order, and keep the
+// first one that finishes and passes `check`. The other transfers are
+// cancelled. Cached URLs that are still fresh are used without a
+// transfer. Fails if none of the URLs pass.
+bool download_first(
+    net*           net,
+    cache*         cache,
+    image_data*    data,
+    char**         urls,
+    size_t         url_count,
+    size_t         parallel,
+    size_t         max_size,
+    download_check check
+);
+
+// Search for images matching `search_term`, stopping once `max_urls` image
+// URLs are found, 0 means no limit. Fails if no URLs are found.
 bool search_images(
+    net*        net,
     size_t*     url_count,
     char***     urls,
+    size_t      max_urls,
     int         offset,
     const char* search_term
 );
+
+// Results of the last search, reused by `search_images_cached`.
+typedef struct search_memo {
+    char*  term;
+    int    offset;
+    char** urls;
+    size_t url_count;
+    time_t expires;
+} search_memo;
+
+void search_memo_free(search_memo* memo);
+
+// Like `search_images`, but reuses the results for the same `search_term`
+// and `offset` for `ttl` seconds, both in `memo` and in `cache` unless it is
+// `NULL`. The URLs are owned by `memo`.
+bool search_images_cached(
+    net*         net,
+    cache*       cache,
+    search_memo* memo,
+    size_t       max_urls,
+    int          offset,
+    const char*  search_term,
+    int          ttl
+);
@@ -0,0 +1,147 @@
+#include "edge.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// The gradient orientation is split into sectors of 3.14159 / 3.5 radians,
+// the first one centered on the positive x axis. Instead of calling `atan2`
+// the orientation is compared against the upper sector boundaries
+// `(j + 0.5) * 3.14159 / 3.5` through the sign of a cross product.
+static const float boundary_cos[4] = {
+    9.009690324e-01f,
+    2.225220427e-01f,
+    -6.234883200e-01f,
+    -1.000000000e+00f,
+};
+
+static const float boundary_sin[4] = {
+    4.338833976e-01f,
+    9.749276591e-01f,
+    7.818326642e-01f,
+    2.653589793e-06f,
+};
+
+// Edges are drawn where the gradient magnitude exceeds `0.9 * LUMA_MAX`.
+// This is the square of that, rounded to the float grid the way `sqrtf`
+// sees it, so the magnitude never needs a square root.
+#define MAGNITUDE_SQUARED 3478817536.0f
+
+static uint8_t classify(int32_t dx, int32_t dy) {
+    float fx = dx;
+    float fy = dy;
+
+    if (!(fx * fx + fy * fy > MAGNITUDE_SQUARED)) return EDGE_NONE;
+
+    float ay = fy < 0 ? -fy : fy;
+    int   k  = 0;
+
+    for (int j = 0; j < 4; j++) {
+        float c = ay * boundary_cos[j] - fx * boundary_sin[j];
+        k += dy < 0 ? c > 0 : c >= 0;
+    }
+
+    // the lower half plane counts sectors clockwise
+    return dy < 0 ? (8 - k) & 7 : k;
+}
+
+#ifdef __SSE2__
+// Classify the four pixels starting at `row[x]`.
+static void classify4(uint8_t* out, const uint16_t* row, int width, int x) {
+    const __m128i zero = _mm_setzero_si128();
+
+#define LOAD(p) \
+    _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*) (p)), zero)
+
+    __m128i u0 = LOAD(row - width + x - 1);
+    __m128i u1 = LOAD(row - width + x);
+    __m128i u2 = LOAD(row - width + x + 1);
+    __m128i m0 = LOAD(row + x - 1);
+    __m128i m2 = LOAD(row + x + 1);
+    __m128i d0 = LOAD(row + width + x - 1);
+    __m128i d1 = LOAD(row + width + x);
+    __m128i d2 = LOAD(row + width + x + 1);
+
+#undef LOAD
+
+    __m128i ix = _mm_add_epi32(
+        _mm_sub_epi32(_mm_add_epi32(u2, d2), _mm_add_epi32(u0, d0)),
+        _mm_slli_epi32(_mm_sub_epi32(m2, m0), 1)
+    );
+    __m128i iy = _mm_add_epi32(
+        _mm_sub_epi32(_mm_add_epi32(d0, d2), _mm_add_epi32(u0, u2)),
+        _mm_slli_epi32(_mm_sub_epi32(d1, u1), 1)
+    );
+
+    __m128 fx = _mm_cvtepi32_ps(ix);
+    __m128 fy = _mm_cvtepi32_ps(iy);
+
+    __m128 strong = _mm_cmpgt_ps(
+        _mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)),
+        _mm_set1_ps(MAGNITUDE_SQUARED)
+    );
+
+    __m128  lower = _mm_cmplt_ps(fy, _mm_setzero_ps());
+    __m128  ay    = _mm_andnot_ps(_mm_set1_ps(-0.0f), fy);
+    __m128i k     = _mm_setzero_si128();
+
+    for (int j = 0; j < 4; j++) {
+        __m128 c = _mm_sub_ps(
+            _mm_mul_ps(ay, _mm_set1_ps(boundary_cos[j])),
+            _mm_mul_ps(fx, _mm_set1_ps(boundary_sin[j]))
+        );
+
+        __m128 gt = _mm_cmpgt_ps(c, _mm_setzero_ps());
+        __m128 ge = _mm_cmpge_ps(c, _mm_setzero_ps());
+        __m128 in = _mm_or_ps(_mm_and_ps(lower, gt), _mm_andnot_ps(lower, ge));
+
+        // comparison masks are -1, so subtracting counts them
+        k = _mm_sub_epi32(k, _mm_castps_si128(in));
+    }
+
+    __m128i mirrored = _mm_and_si128(
+        _mm_sub_epi32(_mm_set1_epi32(8), k),
+        _mm_set1_epi32(7)
+    );
+    __m128i lmask = _mm_castps_si128(lower);
+    __m128i smask = _mm_castps_si128(strong);
+    __m128i index =
+        _mm_or_si128(_mm_and_si128(lmask, mirrored), _mm_andnot_si128(lmask, k));
+
+    index = _mm_or_si128(
+        _mm_and_si128(smask, index),
+        _mm_andnot_si128(smask, _mm_set1_epi32(EDGE_NONE))
+    );
+
+    index = _mm_packs_epi32(index, index);
+    index = _mm_packus_epi16(index, index);
+
+    uint32_t packed = _mm_cvtsi128_si32(index);
+
+    for (int i = 0; i < 4; i++) out[x + i] = packed >> (i * 8);
+}
+#endif
+
+void edge_row(uint8_t* out, const uint16_t* row, int width) {
+    if (width <= 0) return;
+
+    out[0]         = EDGE_NONE;
+    out[width - 1] = EDGE_NONE;
+
+    int x = 1;
+
+#ifdef __SSE2__
+    for (; x + 4 < width; x += 4) classify4(out, row, width, x);
+#endif
+
+    for (; x < width - 1; x++) {
+        const uint16_t* u = row - width + x;
+        const uint16_t* m = row + x;
+        const uint16_t* d = row + width + x;
+
+        int32_t dx = -u[-1] + u[1] - 2 * m[-1] + 2 * m[1] - d[-1] + d[1];
+        int32_t dy = -u[-1] - 2 * u[0] - u[1] + d[-1] + 2 * d[0] + d[1];
+
+        out[x] = classify(dx, dy);
+    }
+}
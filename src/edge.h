@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+// Marks a pixel whose gradient is too weak to be drawn as an edge.
+#define EDGE_NONE 0xff
+
+// Run a Sobel filter over the interior pixels of the luminance row `row`,
+// which must have a row of `width` pixels above and below it. Each
+// `out[x]` gets the index of the matching glyph in an eight entry edge
+// table, or `EDGE_NONE`. The first and last pixel are always `EDGE_NONE`.
+void edge_row(uint8_t* out, const uint16_t* row, int width);
@@ -0,0 +1,49 @@
+#include "frame.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+void frame_init(frame* frame, size_t capacity) {
+    *frame = (struct frame) {0};
+
+    if (capacity) frame_reserve(frame, capacity);
+}
+
+void frame_free(frame* frame) {
+    free(frame->data);
+    *frame = (struct frame) {0};
+}
+
+void frame_reserve(frame* frame, size_t additional) {
+    if (frame->capacity - frame->size >= additional) return;
+
+    size_t capacity = frame->capacity ? frame->capacity * 2 : 4096;
+    while (capacity - frame->size < additional) capacity *= 2;
+
+    char* data = realloc(frame->data, capacity);
+
+    if (!data) abort();
+
+    frame->data     = data;
+    frame->capacity = capacity;
+}
+
+bool frame_flush(frame* frame, int fd) {
+    size_t written = 0;
+
+    while (written < frame->size) {
+        ssize_t n = write(fd, frame->data + written, frame->size - written);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        written += n;
+    }
+
+    frame_clear(frame);
+
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Byte buffer a whole frame is assembled into before it is written out.
+typedef struct frame {
+    size_t size;
+    size_t capacity;
+    char*  data;
+} frame;
+
+void frame_init(frame* frame, size_t capacity);
+void frame_free(frame* frame);
+
+// Make room for at least `additional` more bytes.
+void frame_reserve(frame* frame, size_t additional);
+
+// Write the whole frame to `fd` and clear it.
+bool frame_flush(frame* frame, int fd);
+
+static inline void frame_clear(frame* frame) {
+    frame->size = 0;
+}
+
+static inline void frame_push(frame* frame, char c) {
+    if (frame->size == frame->capacity) frame_reserve(frame, 1);
+
+    frame->data[frame->size++] = c;
+}
+
+static inline void frame_push_bytes(
+    frame*      frame,
+    const char* data,
+    size_t      len
+) {
+    if (frame->capacity - frame->size < len) frame_reserve(frame, len);
+
+    memcpy(frame->data + frame->size, data, len);
+
+    frame->size += len;
+}
+
+static inline void frame_push_repeat(frame* frame, char c, int count) {
+    if (count <= 0) return;
+    if (frame->capacity - frame->size < (size_t) count) {
+        frame_reserve(frame, count);
+    }
+
+    memset(frame->data + frame->size, c, count);
+
+    frame->size += count;
+}
+
+// Append `value` in decimal.
+static inline void frame_push_uint(frame* frame, uint32_t value) {
+    char   digits[10];
+    size_t len = 0;
+
+    do {
+        digits[sizeof digits - ++len] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    frame_push_bytes(frame, digits + sizeof digits - len, len);
+}
+
+// Append the code point `c`, below U+10000, encoded as UTF-8.
+static inline void frame_push_utf8(frame* frame, uint32_t c) {
+    if (c < 0x80) {
+        frame_push(frame, c);
+        return;
+    }
+
+    if (frame->capacity - frame->size < 3) frame_reserve(frame, 3);
+
+    char* out = frame->data + frame->size;
+
+    if (c < 0x800) {
+        out[0] = 0xc0 | c >> 6;
+        out[1] = 0x80 | (c & 0x3f);
+
+        frame->size += 2;
+    } else {
+        out[0] = 0xe0 | c >> 12;
+        out[1] = 0x80 | (c >> 6 & 0x3f);
+        out[2] = 0x80 | (c & 0x3f);
+
+        frame->size += 3;
+    }
+}
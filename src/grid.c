@@ -0,0 +1,123 @@
+#include "grid.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// unchanged cells shorter than a cursor movement are drawn again instead
+#define GRID_GAP 8
+
+void grid_init(grid* grid) {
+    *grid = (struct grid) {0};
+}
+
+void grid_free(grid* grid) {
+    free(grid->cells);
+    *grid = (struct grid) {0};
+}
+
+void grid_resize(grid* grid, int width, int height) {
+    size_t count = (size_t) width * height;
+
+    if (count > grid->capacity || !grid->cells) {
+        cell* cells = realloc(grid->cells, (count ? count : 1) * sizeof *cells);
+        if (!cells) abort();
+
+        grid->cells    = cells;
+        grid->capacity = count;
+    }
+
+    grid->width  = width;
+    grid->height = height;
+}
+
+static bool cell_eq(cell a, cell b) {
+    return a.glyph == b.glyph && a.color == b.color &&
+           a.background == b.background;
+}
+
+// Move the cursor to `row` and `col`, from 0.
+static void grid_move(frame* frame, int row, int col) {
+    frame_push_bytes(frame, "\e[", 2);
+    frame_push_uint(frame, row + 1);
+    frame_push(frame, ';');
+    frame_push_uint(frame, col + 1);
+    frame_push(frame, 'H');
+}
+
+static void grid_cells(
+    frame*      frame,
+    sgr_pen*    pen,
+    const cell* cells,
+    int         count
+) {
+    for (int i = 0; i < count; i++) cell_push(frame, pen, &cells[i]);
+}
+
+void grid_diff(frame* frame, grid* shown, const grid* next) {
+    bool moved = !shown->cells || shown->width != next->width ||
+                 shown->height != next->height || shown->top != next->top ||
+                 shown->left != next->left;
+
+    bool repaint = moved;
+
+    size_t count = (size_t) next->width * next->height;
+
+    if (!repaint) {
+        size_t changed = 0;
+
+        for (size_t i = 0; i < count; i++) {
+            changed += !cell_eq(shown->cells[i], next->cells[i]);
+        }
+
+        repaint = changed > GRID_REPAINT * count;
+    }
+
+    sgr_pen pen = {SGR_DEFAULT, SGR_DEFAULT};
+
+    // the old image may cover parts of the screen the new one does not
+    if (moved) frame_push_bytes(frame, "\e[2J", 4);
+
+    for (int y = 0; y < next->height; y++) {
+        const cell* row  = next->cells + (size_t) y * next->width;
+        const cell* prev = shown->cells + (size_t) y * next->width;
+
+        if (repaint) {
+            grid_move(frame, next->top + y, next->left);
+            grid_cells(frame, &pen, row, next->width);
+            continue;
+        }
+
+        int x = 0;
+
+        while (x < next->width) {
+            if (cell_eq(row[x], prev[x])) {
+                x++;
+                continue;
+            }
+
+            // extend the run over short gaps of unchanged cells
+            int start = x;
+            int last  = x;
+
+            for (x++; x < next->width && x - last <= GRID_GAP; x++) {
+                if (!cell_eq(row[x], prev[x])) last = x;
+            }
+
+            grid_move(frame, next->top + y, next->left + start);
+            grid_cells(frame, &pen, row + start, last - start + 1);
+
+            x = last + 1;
+        }
+    }
+
+    sgr_reset(frame, &pen);
+
+    // leave the cursor below the image
+    grid_move(frame, next->top + next->height, 0);
+
+    grid_resize(shown, next->width, next->height);
+    memcpy(shown->cells, next->cells, count * sizeof *next->cells);
+
+    shown->top  = next->top;
+    shown->left = next->left;
+}
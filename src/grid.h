@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "frame.h"
+#include "sgr.h"
+
+typedef struct cell {
+    sgr_color color;
+    sgr_color background;
+
+    // Unicode code point
+    uint32_t glyph;
+} cell;
+
+// Append `cell` with the escapes that switch `pen` to its colors.
+static inline void cell_push(frame* frame, sgr_pen* pen, const cell* cell) {
+    sgr_set(frame, pen, cell->color, cell->background);
+    frame_push_utf8(frame, cell->glyph);
+}
+
+// Rendered image kept as cells, so the next frame can redraw only what
+// changed.
+typedef struct grid {
+    int width;
+    int height;
+
+    // screen position of the top left cell, from 0
+    int top;
+    int left;
+
+    cell*  cells;
+    size_t capacity;
+} grid;
+
+// Fraction of changed cells above which the whole grid is drawn again.
+#define GRID_REPAINT 0.5
+
+void grid_init(grid* grid);
+void grid_free(grid* grid);
+
+// Make room for `width` by `height` cells, the contents are undefined.
+void grid_resize(grid* grid, int width, int height);
+
+// Append what turns the screen showing `shown` into `next`, then copy `next`
+// into `shown`. Only changed cells are drawn, positioned with cursor
+// movements, unless the size or position changed or more than
+// `GRID_REPAINT` of the cells did.
+void grid_diff(frame* frame, grid* shown, const grid* next);
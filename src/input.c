@@ -0,0 +1,72 @@
+#include "input.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool input_file(image_data* data, const char* path) {
+    *data = (image_data) {0};
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) return false;
+
+    *data = (image_data) {
+        .size     = st.st_size,
+        .data     = map,
+        .map      = map,
+        .map_size = st.st_size,
+    };
+
+    return true;
+}
+
+bool input_stream(image_data* data, int fd, size_t max_size) {
+    *data = (image_data) {0};
+
+    while (true) {
+        if (data->size == data->capacity) {
+            size_t capacity = data->capacity ? data->capacity * 2 : 64 * 1024;
+
+            uint8_t* grown = realloc(data->data, capacity);
+            if (!grown) break;
+
+            data->data     = grown;
+            data->capacity = capacity;
+        }
+
+        ssize_t count = read(
+            fd,
+            data->data + data->size,
+            data->capacity - data->size
+        );
+
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+
+        if (count == 0) return data->size > 0;
+
+        data->size += count;
+
+        if (max_size && data->size > max_size) break;
+    }
+
+    free_image_data(data);
+    *data = (image_data) {0};
+
+    return false;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "download.h"
+
+// Map the file at `path` into `data` without copying it.
+bool input_file(image_data* data, const char* path);
+
+// Read `fd` until the end into `data`, giving up once it is larger than
+// `max_size` bytes, 0 means no limit. `data` is left empty on failure.
+bool input_stream(image_data* data, int fd, size_t max_size);
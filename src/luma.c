@@ -0,0 +1,17 @@
+#include "luma.h"
+
+// Rec. 709 weights scaled by 257 * 2^16, so that white maps to exactly
+// `LUMA_MAX`; they sum to 257 << 16.
+#define LUMA_R 3580769u
+#define LUMA_G 12045936u
+#define LUMA_B 1216047u
+
+void luma_plane(uint16_t* plane, const uint8_t* image, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t r = image[i * 4 + 0];
+        uint32_t g = image[i * 4 + 1];
+        uint32_t b = image[i * 4 + 2];
+
+        plane[i] = (r * LUMA_R + g * LUMA_G + b * LUMA_B + 32768u) >> 16;
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Full scale luminance value, the luminance of white.
+#define LUMA_MAX 65535
+
+// Convert `count` RGBA pixels of `image` to Rec. 709 luminance in
+// `0..LUMA_MAX`.
+void luma_plane(uint16_t* plane, const uint8_t* image, size_t count);
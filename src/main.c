@@ -1,284 +1,381 @@
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
+#define _POSIX_C_SOURCE 200809L
 
-#define STB_IMAGE_RESIZE_IMPLEMENTATION
-#include <stb/stb_image_resize.h>
-
-#include <curl/curl.h>
-#include <math.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "batch.h"
+#include "cache.h"
+#include "convert.h"
+#include "decode.h"
 #include "download.h"
+#include "frame.h"
+#include "input.h"
+#include "net.h"
 #include "opts.h"
+#include "play.h"
+#include "pool.h"
+#include "render.h"
+#include "shape.h"
+#include "timing.h"
 #include "xterm.h"
 
-const char* const tables[] = {
-    " .:-=+*#%@",
-    " _.,-=+:;cba!?0123456789$W#@",
-    " '`^\",:;Il!i><~+_-?][}{1)(|\\//tfjrxnuvczXYUKCLQ0OZmwqpdbkhao*#MW&8%B@$",
-};
-
-const char edges[]       = "|/-\\|/-\\";
-const int  colors[]      = {31, 33, 32, 36, 34, 35};
-const int  colors_high[] = {91, 93, 92, 96, 94, 95};
-
-typedef struct bytes {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
-} bytes;
-
-typedef struct pixel {
-    float r;
-    float g;
-    float b;
-    float a;
-} pixel;
-
-static bytes read_bytes(const uint8_t* image, int x, int y, int w) {
-    uint8_t r = image[(y * w + x) * 4 + 0];
-    uint8_t g = image[(y * w + x) * 4 + 1];
-    uint8_t b = image[(y * w + x) * 4 + 2];
-    uint8_t a = image[(y * w + x) * 4 + 3];
-
-    return (bytes) {r, g, b, a};
+// search results to pick an image from
+#define SEARCH_RESULTS 20
+
+// Probed without decoding, so the transfers are not held up. A truncated
+// download does not win over a whole one.
+static bool decodable(const image_data* image) {
+    return decode_probe(image->data, image->size);
 }
 
-static pixel read_pixel(const uint8_t* image, int x, int y, int w) {
-    bytes bytes = read_bytes(image, x, y, w);
-    return (pixel) {
-        .r = bytes.r / 255.0,
-        .g = bytes.g / 255.0,
-        .b = bytes.b / 255.0,
-        .a = bytes.a / 255.0,
+// Render options from the command line, sizes that were not given are 0.
+static render_opts output_opts(const struct opts* opts) {
+    return (render_opts) {
+        .width     = opts->has_width ? opts->width : 0,
+        .height    = opts->has_height ? opts->height : 0,
+        .center    = opts->center,
+        .edge      = opts->edge,
+        .ansi      = opts->ansi,
+        .xterm     = opts->xterm,
+        .truecolor = opts->truecolor,
+        .mode      = (render_mode) opts->glyphs,
+        .detail    = opts->detail,
+        .dither    = (dither_mode) opts->dither,
+        .quant     = opts->quant,
+        .has_quant = opts->has_quant,
     };
 }
 
-#define MIN(a, b)          ((a) <= (b) ? (a) : (b))
-#define MAX(a, b)          ((a) >= (b) ? (a) : (b))
-#define CLAMP(x, min, max) MIN(MAX(x, min), max)
+// Kept across the ticks of `--watch`.
+typedef struct state {
+    struct opts opts;
+    net*        net;
+    cache*      cache;
+    search_memo search;
+    frame       frame;
+    pool*       pool;
+
+    // set instead of `frame` when the image is an animation
+    animation animation;
+
+    // with `--diff`, the image is rendered into `grid` instead of `frame`
+    // and drawn over `shown`
+    grid grid;
+    grid shown;
+
+    // everything read from stdin, read once and shown on every tick
+    image_data input;
+
+    // of the last `prepare` on the background thread
+    int result;
+} state;
+
+// Get the encoded image from the file, stdin, or a search.
+static bool fetch(state* state, image_data* image_data) {
+    struct opts opts     = state->opts;
+    size_t      max_size = (size_t) opts.max_size * 1024 * 1024;
+
+    if (opts.file) {
+        if (!input_file(image_data, opts.file)) {
+            printf("could not read `%s`\n", opts.file);
+            return false;
+        }
 
-static float read_lightness(const uint8_t* image, int x, int y, int w) {
-    pixel p = read_pixel(image, x, y, w);
-    float l = 0.2126 * p.r + 0.7152 * p.g + 0.0722 * p.b;
+        return true;
+    }
 
-    return CLAMP(l, 0.0, 1.0);
-}
+    if (opts.use_stdin) {
+        if (!state->input.data &&
+            !input_stream(&state->input, STDIN_FILENO, max_size)) {
+            printf("could not read stdin\n");
+            return false;
+        }
+
+        *image_data = state->input;
+        return true;
+    }
 
-static int run(struct opts opts) {
-    size_t urlc;
-    char** urls;
+    bool found = search_images_cached(
+        state->net,
+        state->cache,
+        &state->search,
+        SEARCH_RESULTS,
+        opts.offset,
+        opts.input,
+        opts.search_ttl
+    );
 
-    if (!search_images(&urlc, &urls, opts.offset, opts.input)) {
+    if (!found) {
         printf("search failed\n");
-        return 1;
+        return false;
     }
 
+    size_t urlc = state->search.url_count;
+    char** urls = state->search.urls;
+
+    // shuffle, so the first image to arrive is a random one
     srand(time(NULL));
-    size_t idx = rand() % urlc;
 
-    image_data image_data;
+    for (size_t i = urlc - 1; i > 0; i--) {
+        size_t j = rand() % (i + 1);
+        char*  t = urls[i];
+        urls[i]  = urls[j];
+        urls[j]  = t;
+    }
 
-    if (!download_image(&image_data, urls[idx])) {
+    bool downloaded = download_first(
+        state->net,
+        state->cache,
+        image_data,
+        urls,
+        urlc,
+        opts.parallel,
+        max_size,
+        decodable
+    );
+
+    if (!downloaded) {
         printf("download failed\n");
-        return 1;
+        return false;
     }
 
-    int      width, height, channels;
-    uint8_t* image = stbi_load_from_memory(
-        image_data.data,
-        image_data.size,
-        &width,
-        &height,
-        &channels,
-        4
-    );
+    return true;
+}
 
-    for (size_t i = 0; i < urlc; i++) free(urls[i]);
+// Free an image from `fetch`, the one from stdin is kept for later ticks.
+static void release(state* state, image_data* image_data) {
+    if (image_data->data != state->input.data) free_image_data(image_data);
+}
+
+// Search, download and render an image into `state->frame`.
+static int prepare(state* state) {
+    struct opts opts  = state->opts;
+    frame*      frame = &state->frame;
+    pool*       pool  = state->pool;
 
-    free_image_data(&image_data);
-    free(urls);
+    image_data image_data;
+
+    if (!fetch(state, &image_data)) return 1;
 
     struct winsize w;
     ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
 
-    if (!opts.has_width && !opts.has_height) {
-        float aspect = (float) width / (float) height * 2.0;
+    bool fit = !opts.has_width && !opts.has_height;
+
+    // fit on screen
+    if (fit) w.ws_row -= 2;
 
-        // fit on screen
-        w.ws_row -= 2;
+    render_opts render_opts = output_opts(&opts);
+    render_opts.columns     = w.ws_col;
+    render_opts.rows        = w.ws_row;
 
-        if ((float) w.ws_col / aspect > (float) w.ws_row) {
-            opts.width  = (int) floorf((float) w.ws_row * aspect);
-            opts.height = w.ws_row;
-        } else {
-            opts.width  = w.ws_col;
-            opts.height = (int) floorf((float) w.ws_col / aspect);
+    if (opts.animate) {
+        bool animated = convert_animation(
+            &state->animation,
+            image_data.data,
+            image_data.size,
+            render_opts,
+            w.ws_col,
+            w.ws_row
+        );
+
+        if (animated) {
+            release(state, &image_data);
+            return 0;
         }
     }
 
-    if (!opts.has_width && opts.has_height) {
-        float aspect = (float) width / (float) height * 2.0;
-        opts.width   = (int) floorf((float) opts.height * aspect);
+    bool converted;
+
+    if (opts.diff) {
+        uint8_t* scaled = convert_scale(
+            image_data.data,
+            image_data.size,
+            &render_opts,
+            w.ws_col,
+            w.ws_row
+        );
+
+        if (scaled) render_grid(&state->grid, scaled, &render_opts, pool);
+
+        converted = scaled != NULL;
+        free(scaled);
+    } else {
+        frame_clear(frame);
+
+        converted = convert_image(
+            frame,
+            image_data.data,
+            image_data.size,
+            render_opts,
+            w.ws_col,
+            w.ws_row,
+            pool
+        );
     }
 
-    if (opts.has_width && !opts.has_height) {
-        float aspect = (float) width / (float) height * 2.0;
-        opts.height  = (int) floorf((float) opts.width / aspect);
+    release(state, &image_data);
+
+    if (!converted) {
+        printf("decode failed\n");
+        return 1;
     }
 
-    uint8_t* scaled = malloc(opts.width * opts.height * 4);
-
-    stbir_resize_uint8(
-        image,
-        width,
-        height,
-        width * 4,
-        scaled,
-        opts.width,
-        opts.height,
-        opts.width * 4,
-        4
-    );
+    return 0;
+}
 
-    if (opts.center) {
-        for (int i = 0; i < (w.ws_row - opts.height) / 2; i++) {
-            printf("\n");
-        }
+// Write the prepared image, an animation is played once.
+static int show(state* state) {
+    fflush(stdout);
+
+    if (state->animation.data) {
+        bool played = play(&state->animation, STDOUT_FILENO, NULL);
+        animation_free(&state->animation);
+
+        return played ? 0 : 1;
     }
 
-    printf("\n");
+    if (state->opts.diff) {
+        frame_clear(&state->frame);
+        grid_diff(&state->frame, &state->shown, &state->grid);
+    }
+
+    if (!frame_flush(&state->frame, STDOUT_FILENO)) return 1;
+
+    return 0;
+}
+
+static void* prepare_thread(void* data) {
+    state* state = data;
+
+    state->result = prepare(state);
+
+    return NULL;
+}
 
-    for (int y = 0; y < opts.height; y++) {
-        if (opts.center) {
-            for (int i = 0; i < (w.ws_col - opts.width) / 2; i++) {
-                printf(" ");
-            }
+// Show a new image every `--watch` seconds. The next image is prepared in
+// the background while the current one is shown, and the ticks follow
+// absolute deadlines so they do not drift. Animations loop until the next
+// image is due.
+static int watch(state* state) {
+    int interval = state->opts.watch;
+    int result   = prepare(state);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    while (result == 0) {
+        // taken out of `state`, the next image is prepared into it
+        animation current = state->animation;
+        state->animation  = (animation) {0};
+
+        if (!current.data) result = show(state);
+        if (result != 0) break;
+
+        pthread_t thread;
+
+        if (pthread_create(&thread, NULL, prepare_thread, state) != 0) {
+            animation_free(&current);
+            return 1;
         }
 
-        for (int x = 0; x < opts.width; x++) {
-            pixel p = read_pixel(scaled, x, y, opts.width);
-
-            if (opts.has_quant) {
-                p.r = roundf(p.r * opts.quant) / opts.quant;
-                p.g = roundf(p.g * opts.quant) / opts.quant;
-                p.b = roundf(p.b * opts.quant) / opts.quant;
-                p.a = roundf(p.a * opts.quant) / opts.quant;
-            }
-
-            if (opts.xterm) {
-                bytes bytes = {
-                    .r = roundf(p.r * 255.0),
-                    .g = roundf(p.g * 255.0),
-                    .b = roundf(p.b * 255.0),
-                    .a = roundf(p.a * 255.0),
-                };
-
-                uint8_t index = rgb_to_xterm(bytes.r, bytes.g, bytes.b);
-
-                printf("\e[38;5;%hhum", index);
-            }
-            if (opts.ansi) {
-                float cmax = fmaxf(fmaxf(p.r, p.g), p.b);
-                float cmin = fminf(fminf(p.r, p.g), p.b);
-                float dc   = (cmax - cmin) / 2.0;
-                float h;
-
-                float l = (cmax + cmin) / 2.0;
-                float s = l < 0.5 ? dc / (cmax + cmin)
-                                  : dc / (2.0 - cmax - cmin);
-
-                if (s > 0.1) {
-                    if (cmax == p.r) {
-                        h = fmodf((p.g - p.b) / dc, 6.0);
-                    } else if (cmax == p.g) {
-                        h = (p.b - p.r) / dc + 2.0;
-                    } else {
-                        h = (p.r - p.g) / dc + 4.0;
-                    }
-
-                    int index = (int) roundf(h + 5.5) % 6;
-                    int color = l > 0.7 ? colors_high[index] : colors[index];
-
-                    printf("\e[0;%im", color);
-                } else {
-                    printf("\e[0;0m");
-                }
-            }
-
-            float l11 = read_lightness(scaled, x, y, opts.width);
-
-            if (x > 0 && x < opts.width - 1 && y > 1 && y < opts.height - 1 &&
-                opts.edge) {
-                float l00 = read_lightness(scaled, x - 1, y - 1, opts.width);
-                float l10 = read_lightness(scaled, x + 0, y - 1, opts.width);
-                float l20 = read_lightness(scaled, x + 1, y - 1, opts.width);
-                float l01 = read_lightness(scaled, x - 1, y + 0, opts.width);
-                float l21 = read_lightness(scaled, x + 1, y + 0, opts.width);
-                float l02 = read_lightness(scaled, x - 1, y + 1, opts.width);
-                float l12 = read_lightness(scaled, x + 0, y + 1, opts.width);
-                float l22 = read_lightness(scaled, x + 1, y + 1, opts.width);
-
-                float dx = -1.0 * l00 + 1.0 * l20 + -2.0 * l01 + 2.0 * l21 +
-                           -1.0 * l02 + 1.0 * l22;
-
-                float dy = -1.0 * l00 + -2.0 * l10 + -1.0 * l20 + 1.0 * l02 +
-                           2.0 * l12 + 1.0 * l22;
-
-                float d = sqrtf(dx * dx + dy * dy);
-                float o = atan2(dy, dx);
-
-                if (d > 0.9) {
-                    printf(
-                        "%c",
-                        edges[(int) round((o / 3.14159 * 3.5 + 8.0)) % 8]
-                    );
-                    continue;
-                }
-            }
-
-            int idx = floorf(l11 * (float) (strlen(tables[opts.detail]) - 1));
-
-            printf("%c", tables[opts.detail][idx]);
+        deadline.tv_sec += interval;
+
+        if (current.data && !play(&current, STDOUT_FILENO, &deadline)) {
+            result = 1;
         }
 
-        printf("\n");
-    }
+        animation_free(&current);
+
+        timing_sleep_until(&deadline);
+
+        pthread_join(thread, NULL);
 
-    if (opts.center) {
-        for (int i = 0; i < (w.ws_row - opts.height) / 2; i++) {
-            printf("\n");
+        if (result == 0) result = state->result;
+
+        // skip the ticks a slow image overran, so the next ones stay on time
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        time_t behind = now.tv_sec - deadline.tv_sec;
+
+        if (interval > 0 && behind >= interval) {
+            deadline.tv_sec += behind / interval * interval;
         }
     }
 
-    stbi_image_free(image);
-    free(scaled);
-
-    return 0;
+    return result;
 }
 
 int main(int argc, const char** argv) {
-    struct opts opts = parse_opts(argc, argv);
+    state state = {.opts = parse_opts(argc, argv)};
+
+    bool local = state.opts.file || state.opts.use_stdin || state.opts.batch;
+
+    if (!local && !state.opts.input) {
+        printf("no search term, file or --stdin given\n");
+        return 1;
+    }
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
+    // local images never touch the network, so curl is not even
+    // initialized for them
+    if (!local) {
+        state.net = net_new();
 
-    int result = 0;
+        if (!state.net) {
+            printf("network initialization failed\n");
+            return 1;
+        }
 
-    if (opts.has_watch) {
-        while (result == 0) {
-            result = run(opts);
-            sleep(opts.watch);
+        // the cache is only an optimization, run without it if it cannot
+        // be opened
+        if (state.opts.cache_size > 0) {
+            size_t budget = (size_t) state.opts.cache_size * 1024 * 1024;
+            state.cache   = cache_open(budget);
         }
+    }
+
+    xterm_init();
+    shape_init();
+
+    frame_init(&state.frame, 0);
+
+    state.pool = pool_new(state.opts.threads);
+
+    int result;
+
+    if (state.opts.batch) {
+        // without a size, images are fit into the default one
+        batch_opts batch_opts = {
+            .render     = output_opts(&state.opts),
+            .fit_width  = state.opts.width,
+            .fit_height = state.opts.height,
+            .output     = state.opts.output,
+            .memory     = (size_t) state.opts.memory * 1024 * 1024,
+        };
+
+        result = batch_run(state.opts.batch, &batch_opts, state.pool) ? 0 : 1;
+    } else if (state.opts.has_watch) {
+        result = watch(&state);
     } else {
-        result = run(opts);
+        result = prepare(&state);
+        if (result == 0) result = show(&state);
     }
 
-    curl_global_cleanup();
+    search_memo_free(&state.search);
+    animation_free(&state.animation);
+    grid_free(&state.grid);
+    grid_free(&state.shown);
+    free_image_data(&state.input);
+    pool_free(state.pool);
+    frame_free(&state.frame);
+    cache_close(state.cache);
+    net_free(state.net);
 
     return result;
 }
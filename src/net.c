@@ -0,0 +1,91 @@
+#include "net.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+struct net {
+    CURLSH* share;
+    CURL*   easy;
+
+    pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+};
+
+static void net_lock(
+    CURL*            curl,
+    curl_lock_data   data,
+    curl_lock_access access,
+    void*            user_data
+) {
+    (void) curl;
+    (void) access;
+
+    net* net = user_data;
+    pthread_mutex_lock(&net->locks[data]);
+}
+
+static void net_unlock(CURL* curl, curl_lock_data data, void* user_data) {
+    (void) curl;
+
+    net* net = user_data;
+    pthread_mutex_unlock(&net->locks[data]);
+}
+
+net* net_new(void) {
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) return NULL;
+
+    net* net = calloc(1, sizeof *net);
+
+    if (!net) {
+        curl_global_cleanup();
+        return NULL;
+    }
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_init(&net->locks[i], NULL);
+    }
+
+    net->share = curl_share_init();
+    net->easy  = curl_easy_init();
+
+    if (!net->share || !net->easy) {
+        net_free(net);
+        return NULL;
+    }
+
+    curl_share_setopt(net->share, CURLSHOPT_LOCKFUNC, net_lock);
+    curl_share_setopt(net->share, CURLSHOPT_UNLOCKFUNC, net_unlock);
+    curl_share_setopt(net->share, CURLSHOPT_USERDATA, net);
+    curl_share_setopt(net->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(net->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(net->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+    return net;
+}
+
+void net_free(net* net) {
+    if (!net) return;
+
+    // the handle has to let go of the share first
+    if (net->easy) curl_easy_cleanup(net->easy);
+    if (net->share) curl_share_cleanup(net->share);
+
+    for (int i = 0; i < CURL_LOCK_DATA_LAST; i++) {
+        pthread_mutex_destroy(&net->locks[i]);
+    }
+
+    free(net);
+    curl_global_cleanup();
+}
+
+void net_share(net* net, CURL* curl) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, net->share);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+}
+
+CURL* net_easy(net* net) {
+    curl_easy_reset(net->easy);
+    net_share(net, net->easy);
+
+    return net->easy;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <curl/curl.h>
+
+// Network state kept for the whole run, so repeated requests reuse DNS
+// lookups, TLS sessions and open connections.
+typedef struct net net;
+
+// Initialize curl and create the shared state, returns `NULL` on failure.
+net* net_new(void);
+void net_free(net* net);
+
+// Easy handle with the common options set, valid until the next call. It
+// is reset between uses but keeps its connections.
+CURL* net_easy(net* net);
+
+// Set the common options on `curl` and attach it to the shared caches, for
+// transfers that run alongside the one from `net_easy`.
+void net_share(net* net, CURL* curl);
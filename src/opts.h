@@ -5,6 +5,17 @@
 struct opts {
     char* input;
 
+    char* file;
+    bool  use_stdin;
+
+    char* batch;
+    char* output;
+    // in MiB, 0 for no limit
+    int   memory;
+
+    bool  animate;
+    bool  diff;
+
     int   offset;
 
     int   watch;
@@ -22,6 +33,7 @@ struct opts {
 
     bool  ansi;
     bool  xterm;
+    bool  truecolor;
 
     enum {
         DETAIL_LOW  = 0,
@@ -29,10 +41,46 @@ struct opts {
         DETAIL_HIGH = 2,
     } detail;
 
+    enum {
+        GLYPHS_ASCII   = 0,
+        GLYPHS_HALF    = 1,
+        GLYPHS_BRAILLE = 2,
+        GLYPHS_SHAPE   = 3,
+    } glyphs;
+
+    enum {
+        DITHERING_NONE    = 0,
+        DITHERING_ORDERED = 1,
+        DITHERING_DIFFUSE = 2,
+    } dither;
+
     int  quant;
     bool has_quant;
+
+    int  threads;
+
+    // in MiB, 0 for no limit
+    int  max_size;
+
+    int  parallel;
+
+    // in MiB, 0 disables the cache
+    int  cache_size;
+
+    // in seconds, 0 searches every time
+    int  search_ttl;
 };
 
+// The search term is optional, images can come from `--file` or `--stdin`
+// instead.
+static int parse_term(void* data, int argc, const char** argv) {
+    if (argc == 0) return 0;
+
+    *(const char**) data = argv[0];
+
+    return 1;
+}
+
 static int parse_detail(void* data, int argc, const char** argv) {
     (void) argc;
 
@@ -52,11 +100,87 @@ static int parse_detail(void* data, int argc, const char** argv) {
     }
 }
 
+static int parse_glyphs(void* data, int argc, const char** argv) {
+    (void) argc;
+
+    if (strcmp(argv[0], "ascii") == 0) {
+        *(int*) data = GLYPHS_ASCII;
+        return 1;
+    } else if (strcmp(argv[0], "half") == 0) {
+        *(int*) data = GLYPHS_HALF;
+        return 1;
+    } else if (strcmp(argv[0], "braille") == 0) {
+        *(int*) data = GLYPHS_BRAILLE;
+        return 1;
+    } else if (strcmp(argv[0], "shape") == 0) {
+        *(int*) data = GLYPHS_SHAPE;
+        return 1;
+    } else {
+        arg_err("invalid glyphs `%s`\n", argv[0]);
+
+        return -1;
+    }
+}
+
+static int parse_dither(void* data, int argc, const char** argv) {
+    (void) argc;
+
+    if (strcmp(argv[0], "none") == 0) {
+        *(int*) data = DITHERING_NONE;
+        return 1;
+    } else if (strcmp(argv[0], "ordered") == 0) {
+        *(int*) data = DITHERING_ORDERED;
+        return 1;
+    } else if (strcmp(argv[0], "diffuse") == 0) {
+        *(int*) data = DITHERING_DIFFUSE;
+        return 1;
+    } else {
+        arg_err("invalid dithering `%s`\n", argv[0]);
+
+        return -1;
+    }
+}
+
+// Size limit of `--max-size` in MiB, a negative one would wrap around to a
+// huge limit.
+static int parse_max_size(void* data, int argc, const char** argv) {
+    int parsed = arg_int.parse(data, argc, argv);
+
+    if (parsed == 1 && *(int*) data < 0) {
+        arg_err("invalid size `%s`, expected at least 0\n", argv[0]);
+
+        return -1;
+    }
+
+    return parsed;
+}
+
+// Level count of `--quantize`, the quantization divides by it and more
+// levels than channel values would overflow the level arithmetic.
+static int parse_quant(void* data, int argc, const char** argv) {
+    int parsed = arg_int.parse(data, argc, argv);
+
+    if (parsed == 1 && (*(int*) data < 1 || *(int*) data > 255)) {
+        arg_err("invalid quantization `%s`, expected 1 to 255\n", argv[0]);
+
+        return -1;
+    }
+
+    return parsed;
+}
+
 struct opts parse_opts(int argc, const char** argv) {
     struct opts opts = {0};
     opts.width = 100;
     opts.height = 50;
     opts.detail = DETAIL_MID;
+    opts.threads = 1;
+    opts.max_size = 64;
+    opts.parallel = 4;
+    opts.cache_size = 256;
+    opts.search_ttl = 300;
+    opts.output = ".";
+    opts.memory = 256;
 
     cmd main = cmd_new("asciify");
     cmd_desc(
@@ -67,7 +191,26 @@ struct opts parse_opts(int argc, const char** argv) {
 
     arg input = cmd_arg(main, "search term");
     arg_help (input, "search term");
-    arg_value(input, &opts.input, arg_str);
+    arg_value(
+        input,
+        &opts.input,
+        (arg_parser){
+            .parse = parse_term,
+            .count = 0,
+        }
+    );
+
+    arg file = cmd_arg(main, "file");
+    arg_help (file, "show an image file instead of searching");
+    arg_usage(file, "<path>");
+    arg_long (file, "file");
+    arg_short(file, 'f');
+    arg_value(file, &opts.file, arg_str);
+
+    arg use_stdin = cmd_arg(main, "stdin");
+    arg_help (use_stdin, "show an image read from stdin instead of searching");
+    arg_long (use_stdin, "stdin");
+    arg_check(use_stdin, &opts.use_stdin);
 
     arg offset = cmd_arg(main, "offset");
     arg_help (offset, "search offset");
@@ -84,6 +227,36 @@ struct opts parse_opts(int argc, const char** argv) {
     arg_check(watch, &opts.has_watch);
     arg_value(watch, &opts.watch, arg_int);
 
+    arg batch = cmd_arg(main, "batch");
+    arg_help (batch, "convert every image in a directory or list file");
+    arg_usage(batch, "<path>");
+    arg_long (batch, "batch");
+    arg_short(batch, 'b');
+    arg_value(batch, &opts.batch, arg_str);
+
+    arg output = cmd_arg(main, "output");
+    arg_help (output, "directory batch renderings are written to");
+    arg_usage(output, "<dir>");
+    arg_long (output, "output");
+    arg_value(output, &opts.output, arg_str);
+
+    arg memory = cmd_arg(main, "memory");
+    arg_help (memory, "MiB of decoded images in flight in batch mode");
+    arg_usage(memory, "<MiB>");
+    arg_long (memory, "memory");
+    arg_value(memory, &opts.memory, arg_int);
+
+    arg animate = cmd_arg(main, "animate");
+    arg_help (animate, "play animated GIFs");
+    arg_long (animate, "animate");
+    arg_short(animate, 'A');
+    arg_check(animate, &opts.animate);
+
+    arg diff = cmd_arg(main, "diff");
+    arg_help (diff, "redraw only the characters that changed between images");
+    arg_long (diff, "diff");
+    arg_check(diff, &opts.diff);
+
     arg width = cmd_arg(main, "width");
     arg_help (width, "width of output image");
     arg_usage(width, "<width>");
@@ -124,6 +297,33 @@ struct opts parse_opts(int argc, const char** argv) {
         }
     );
 
+    arg glyphs = cmd_arg(main, "glyphs");
+    arg_help (glyphs, "characters, half blocks, braille or matched shapes");
+    arg_usage(glyphs, "<ascii|half|braille|shape>");
+    arg_long (glyphs, "glyphs");
+    arg_short(glyphs, 'g');
+    arg_value(
+        glyphs,
+        &opts.glyphs,
+        (arg_parser){
+            .parse = parse_glyphs,
+            .count = 1,
+        }
+    );
+
+    arg dither = cmd_arg(main, "dither");
+    arg_help (dither, "dither colors, glyphs and --quantize, diffuse ignores --threads");
+    arg_usage(dither, "<none|ordered|diffuse>");
+    arg_long (dither, "dither");
+    arg_value(
+        dither,
+        &opts.dither,
+        (arg_parser){
+            .parse = parse_dither,
+            .count = 1,
+        }
+    );
+
     arg ansi = cmd_arg(main, "color");
     arg_help (ansi, "enable ansi colors");
     arg_long (ansi, "ansi");
@@ -136,13 +336,65 @@ struct opts parse_opts(int argc, const char** argv) {
     arg_short(xterm, 'x');
     arg_check(xterm, &opts.xterm);
 
+    arg truecolor = cmd_arg(main, "truecolor");
+    arg_help (truecolor, "enable 24-bit colors");
+    arg_long (truecolor, "truecolor");
+    arg_short(truecolor, 'T');
+    arg_check(truecolor, &opts.truecolor);
+
     arg quant = cmd_arg(main, "quantize");
     arg_help (quant, "quantize colors");
     arg_usage(quant, "<count>");
     arg_long (quant, "quantize");
     arg_short(quant, 'q');
     arg_check(quant, &opts.has_quant);
-    arg_value(quant, &opts.quant, arg_int);
+    arg_value(
+        quant,
+        &opts.quant,
+        (arg_parser) {
+            .parse = parse_quant,
+            .count = 1,
+        }
+    );
+
+    arg threads = cmd_arg(main, "threads");
+    arg_help (threads, "number of threads to render with");
+    arg_usage(threads, "<count>");
+    arg_long (threads, "threads");
+    arg_short(threads, 't');
+    arg_value(threads, &opts.threads, arg_int);
+
+    arg max_size = cmd_arg(main, "max-size");
+    arg_help (max_size, "largest image to download in MiB, 0 for no limit");
+    arg_usage(max_size, "<MiB>");
+    arg_long (max_size, "max-size");
+    arg_value(
+        max_size,
+        &opts.max_size,
+        (arg_parser) {
+            .parse = parse_max_size,
+            .count = 1,
+        }
+    );
+
+    arg parallel = cmd_arg(main, "parallel");
+    arg_help (parallel, "number of images to download at once");
+    arg_usage(parallel, "<count>");
+    arg_long (parallel, "parallel");
+    arg_short(parallel, 'p');
+    arg_value(parallel, &opts.parallel, arg_int);
+
+    arg cache_size = cmd_arg(main, "cache-size");
+    arg_help (cache_size, "size of the image cache in MiB, 0 to disable it");
+    arg_usage(cache_size, "<MiB>");
+    arg_long (cache_size, "cache-size");
+    arg_value(cache_size, &opts.cache_size, arg_int);
+
+    arg search_ttl = cmd_arg(main, "search-ttl");
+    arg_help (search_ttl, "seconds to reuse search results for");
+    arg_usage(search_ttl, "<seconds>");
+    arg_long (search_ttl, "search-ttl");
+    arg_value(search_ttl, &opts.search_ttl, arg_int);
 
     cmd_parse(main, argc, argv);
     cmd_free(main);
@@ -0,0 +1,208 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "play.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "decode.h"
+#include "frame.h"
+#include "grid.h"
+#include "render.h"
+#include "timing.h"
+
+// frames rendered ahead of the one being shown
+#define PLAY_RING 8
+
+// browsers show frames with a shorter delay for this long
+#define PLAY_MIN_DELAY 20
+#define PLAY_DEFAULT_DELAY 100
+
+typedef struct player {
+    const animation* animation;
+    bool             loop;
+
+    // frame `n` is rendered into `ring[n % PLAY_RING]` and shown for
+    // `delays[n % PLAY_RING]`
+    grid ring[PLAY_RING];
+    int  delays[PLAY_RING];
+
+    pthread_mutex_t lock;
+    pthread_cond_t  changed;
+
+    uint64_t rendered;
+    uint64_t shown;
+    bool     stop;
+
+    // set once no more frames are rendered
+    bool done;
+} player;
+
+// Decode, scale and render the frames one at a time as the ring has room,
+// starting over at the end when looping.
+static void* player_thread(void* data) {
+    player*          player    = data;
+    const animation* animation = player->animation;
+
+    int pixel_width, pixel_height;
+    render_pixels(&animation->opts, &pixel_width, &pixel_height);
+
+    uint8_t* scaled = malloc((size_t) pixel_width * pixel_height * 4);
+
+    int         width, height;
+    decode_gif* gif =
+        decode_gif_open(animation->data, animation->size, &width, &height);
+
+    for (uint64_t n = 0; scaled && gif; n++) {
+        pthread_mutex_lock(&player->lock);
+
+        while (!player->stop && n - player->shown >= PLAY_RING) {
+            pthread_cond_wait(&player->changed, &player->lock);
+        }
+
+        bool stop = player->stop;
+        pthread_mutex_unlock(&player->lock);
+
+        if (stop) break;
+
+        int            delay;
+        const uint8_t* frame = decode_gif_next(gif, &delay);
+
+        if (!frame && player->loop && n > 0) {
+            decode_gif_close(gif);
+
+            gif = decode_gif_open(
+                animation->data,
+                animation->size,
+                &width,
+                &height
+            );
+
+            frame = gif ? decode_gif_next(gif, &delay) : NULL;
+        }
+
+        if (!frame) break;
+
+        animation_scale(animation, frame, width, height, scaled);
+
+        render_grid(
+            &player->ring[n % PLAY_RING],
+            scaled,
+            &animation->opts,
+            NULL
+        );
+
+        pthread_mutex_lock(&player->lock);
+        player->delays[n % PLAY_RING] = delay;
+        player->rendered              = n + 1;
+        pthread_cond_broadcast(&player->changed);
+        pthread_mutex_unlock(&player->lock);
+    }
+
+    decode_gif_close(gif);
+    free(scaled);
+
+    pthread_mutex_lock(&player->lock);
+    player->done = true;
+    pthread_cond_broadcast(&player->changed);
+    pthread_mutex_unlock(&player->lock);
+
+    return NULL;
+}
+
+static int frame_delay(int delay) {
+    return delay < PLAY_MIN_DELAY ? PLAY_DEFAULT_DELAY : delay;
+}
+
+bool play(const animation* animation, int fd, const struct timespec* until) {
+    player player = {
+        .animation = animation,
+        .loop      = until != NULL,
+    };
+
+    for (int i = 0; i < PLAY_RING; i++) grid_init(&player.ring[i]);
+
+    pthread_mutex_init(&player.lock, NULL);
+    pthread_cond_init(&player.changed, NULL);
+
+    pthread_t thread;
+    bool      started = !pthread_create(&thread, NULL, player_thread, &player);
+    bool      ok      = started;
+
+    // each frame only draws the cells that changed since the last one shown
+    grid  shown;
+    frame out;
+
+    grid_init(&shown);
+    frame_init(&out, 0);
+
+    // frames are due at the sum of the delays before them, not at the time
+    // the last one happened to be shown
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    for (uint64_t n = 0; ok; n++) {
+        if (until && !timing_before(&deadline, until)) break;
+
+        pthread_mutex_lock(&player.lock);
+
+        // the frame after this one is waited for too, to tell if this one
+        // is the last
+        while (!player.done && player.rendered <= n + 1) {
+            pthread_cond_wait(&player.changed, &player.lock);
+        }
+
+        bool rendered = player.rendered > n;
+        bool last     = player.done && player.rendered == n + 1;
+        int  delay    = player.delays[n % PLAY_RING];
+
+        pthread_mutex_unlock(&player.lock);
+
+        // an animation that fails to decode at the start is an error
+        if (!rendered) {
+            ok = n > 0;
+            break;
+        }
+
+        struct timespec next = deadline;
+        timing_add_ms(&next, frame_delay(delay));
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        // drop a frame whose time is already over, unless it is the last
+        if (timing_before(&now, &next) || last) {
+            grid_diff(&out, &shown, &player.ring[n % PLAY_RING]);
+
+            timing_sleep_until(&deadline);
+            ok = frame_flush(&out, fd);
+        }
+
+        pthread_mutex_lock(&player.lock);
+        player.shown = n + 1;
+        pthread_cond_broadcast(&player.changed);
+        pthread_mutex_unlock(&player.lock);
+
+        deadline = next;
+    }
+
+    if (ok && !until) timing_sleep_until(&deadline);
+
+    pthread_mutex_lock(&player.lock);
+    player.stop = true;
+    pthread_cond_broadcast(&player.changed);
+    pthread_mutex_unlock(&player.lock);
+
+    if (started) pthread_join(thread, NULL);
+
+    pthread_mutex_destroy(&player.lock);
+    pthread_cond_destroy(&player.changed);
+
+    for (int i = 0; i < PLAY_RING; i++) grid_free(&player.ring[i]);
+
+    grid_free(&shown);
+    frame_free(&out);
+
+    return ok;
+}
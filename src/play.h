@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdbool.h>
+#include <time.h>
+
+#include "convert.h"
+
+// Play `animation` to `fd` with the delays of its frames, looping until
+// `until` on the monotonic clock, or once if it is `NULL`. Frames are
+// decoded, scaled and rendered a few ahead on a background thread, and
+// frames that are already late are dropped to stay on time.
+bool play(const animation* animation, int fd, const struct timespec* until);
@@ -0,0 +1,139 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct pool {
+    pthread_mutex_t lock;
+    pthread_cond_t  work;
+    pthread_cond_t  done;
+
+    pthread_t* workers;
+    int        threads;
+
+    // current batch, `generation` is bumped for every new batch
+    pool_task task;
+    void*     data;
+    int       count;
+    int       next;
+    int       finished;
+    unsigned  generation;
+
+    bool shutdown;
+};
+
+// Run tasks of the current batch until there are none left, called with
+// the lock held.
+static void pool_drain(pool* pool) {
+    while (pool->next < pool->count) {
+        int index = pool->next++;
+
+        pthread_mutex_unlock(&pool->lock);
+        pool->task(pool->data, index);
+        pthread_mutex_lock(&pool->lock);
+
+        if (++pool->finished == pool->count) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+}
+
+static void* pool_worker(void* data) {
+    pool*    pool = data;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (true) {
+        while (!pool->shutdown && pool->generation == seen) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+
+        if (pool->shutdown) break;
+
+        seen = pool->generation;
+        pool_drain(pool);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+pool* pool_new(int threads) {
+    if (threads < 2) return NULL;
+
+    pool* pool = calloc(1, sizeof *pool);
+    if (!pool) return NULL;
+
+    pool->workers = calloc(threads - 1, sizeof *pool->workers);
+
+    if (!pool->workers) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->threads = 1;
+
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&pool->workers[i], NULL, pool_worker, pool)) break;
+        pool->threads += 1;
+    }
+
+    return pool;
+}
+
+void pool_free(pool* pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads - 1; i++) {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+
+    free(pool->workers);
+    free(pool);
+}
+
+int pool_threads(const pool* pool) {
+    return pool ? pool->threads : 1;
+}
+
+void pool_run(pool* pool, pool_task task, void* data, int count) {
+    if (!pool) {
+        for (int i = 0; i < count; i++) task(data, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    pool->task     = task;
+    pool->data     = data;
+    pool->count    = count;
+    pool->next     = 0;
+    pool->finished = 0;
+    pool->generation += 1;
+
+    pthread_cond_broadcast(&pool->work);
+
+    pool_drain(pool);
+
+    while (pool->finished < pool->count) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Fixed set of worker threads running batches of indexed tasks.
+typedef struct pool pool;
+
+typedef void (*pool_task)(void* data, int index);
+
+// Create a pool running tasks on `threads` threads, the calling thread
+// included. Returns `NULL` if `threads` is less than 2 or on failure.
+pool* pool_new(int threads);
+void  pool_free(pool* pool);
+
+int pool_threads(const pool* pool);
+
+// Run `task(data, i)` for every `i` in `0..count` and wait for all of them.
+// A `NULL` pool runs the tasks on the calling thread.
+void pool_run(pool* pool, pool_task task, void* data, int count);
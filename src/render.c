@@ -0,0 +1,817 @@
+#include "render.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ansi.h"
+#include "edge.h"
+#include "luma.h"
+#include "sgr.h"
+#include "xterm.h"
+
+const char* const tables[] = {
+    " .:-=+*#%@",
+    " _.,-=+:;cba!?0123456789$W#@",
+    " '`^\",:;Il!i><~+_-?][}{1)(|\\//tfjrxnuvczXYUKCLQ0OZmwqpdbkhao*#MW&8%B@$",
+};
+
+const char edges[] = "|/-\\|/-\\";
+
+// blank, upper half, lower half and full block, indexed by the lit halves
+static const uint32_t half_blocks[] = {' ', 0x2580, 0x2584, 0x2588};
+
+#define HALF_UPPER 0x2580
+
+// ANSI black, bright black, white and bright white, by luminance. Half
+// blocks use them for the grays `--ansi` leaves uncolored, in the default
+// colors both halves would look the same.
+static const uint8_t ansi_grays[] = {30, 90, 37, 97};
+
+// Braille pattern without dots, plus the bits of the raised dots. The dots
+// are numbered down the left column and then the right one, with the bottom
+// row added last.
+#define BRAILLE_BLANK 0x2800
+
+static const uint8_t braille_left[]  = {0, 1, 2, 6};
+static const uint8_t braille_right[] = {3, 4, 5, 7};
+
+// luminance above which a dot or half block is lit
+#define DOT_THRESHOLD (LUMA_MAX / 2)
+
+// about the distance between the levels of the xterm color cube
+#define XTERM_STEP 40
+
+// longest escape sequence, setting both colors, plus a three byte glyph
+#define CELL_MAX 41
+
+#define MIN(a, b) ((a) <= (b) ? (a) : (b))
+#define MAX(a, b) ((a) >= (b) ? (a) : (b))
+
+// Level in `0..quant` a channel is rounded to by `--quantize`, halves
+// rounded up.
+static uint16_t quant_level(uint8_t value, int quant) {
+    return (2 * value * quant + 255) / 510;
+}
+
+// Channel value after the `--quantize` rounding, as seen by the xterm
+// palette search.
+static uint8_t quantize(uint8_t value, int quant) {
+    return (510 * quant_level(value, quant) + quant) / (2 * quant);
+}
+
+// State shared by the bands of one frame.
+typedef struct render_job {
+    const uint8_t*     image;
+    const render_opts* opts;
+
+    uint16_t* luma;
+    size_t    table_len;
+    int       pad_cols;
+
+    uint8_t  quant_table[256];
+    uint16_t quant_levels[256];
+
+    // offsets and thresholds of `DITHER_ORDERED`, by Bayer threshold
+    int16_t  quant_offsets[DITHER_LEVELS];
+    int16_t  xterm_offsets[DITHER_LEVELS];
+    int32_t  ramp_offsets[DITHER_LEVELS];
+    uint16_t dot_thresholds[DITHER_LEVELS];
+
+    // size of `image` and `luma` in pixels
+    int pixel_width;
+    int pixel_height;
+
+    // each band of rows is rendered into its own slice, or into `grid`
+    frame* slices;
+    grid*  grid;
+    int    bands;
+
+    // bands of the luminance pass, which has no diffusion to keep whole
+    int luma_bands;
+} render_job;
+
+// Per band buffers for one row.
+typedef struct render_scratch {
+    uint8_t* edge;
+    uint8_t* xterm;
+    uint8_t* ansi;
+    uint8_t* quantized;
+    uint8_t* average;
+    uint8_t* dots;
+    char*    shapes;
+
+    // error of `DITHER_DIFFUSE`, in channel values for the colors of the
+    // cells and in luminance for the pixels of the glyphs
+    diffuser color_error;
+    diffuser glyph_error;
+} render_scratch;
+
+static void scratch_init(render_scratch* scratch, const render_job* job) {
+    int width = job->opts->width;
+
+    *scratch = (render_scratch) {
+        .edge      = malloc(width),
+        .xterm     = malloc(width),
+        .ansi      = malloc(width),
+        .quantized = malloc((size_t) width * 4),
+        .average   = malloc((size_t) width * 4),
+        .dots      = malloc(width),
+        .shapes    = malloc(width),
+    };
+
+    if (job->opts->dither == DITHER_DIFFUSE) {
+        diffuser_init(&scratch->color_error, width, 3);
+        diffuser_init(&scratch->glyph_error, job->pixel_width, 1);
+    }
+}
+
+static void scratch_free(render_scratch* scratch) {
+    free(scratch->edge);
+    free(scratch->xterm);
+    free(scratch->ansi);
+    free(scratch->quantized);
+    free(scratch->average);
+    free(scratch->dots);
+    free(scratch->shapes);
+
+    diffuser_free(&scratch->color_error);
+    diffuser_free(&scratch->glyph_error);
+}
+
+// Rows of `band` when the frame is split into `bands`.
+static void band_rows(
+    const render_job* job,
+    int               bands,
+    int               band,
+    int*              y0,
+    int*              y1
+) {
+    *y0 = (int) ((int64_t) job->opts->height * band / bands);
+    *y1 = (int) ((int64_t) job->opts->height * (band + 1) / bands);
+}
+
+static void luma_task(void* data, int band) {
+    const render_job* job   = data;
+    int               width = job->pixel_width;
+    int               y0, y1;
+
+    band_rows(job, job->luma_bands, band, &y0, &y1);
+
+    // the bands are in cells, the plane in pixels
+    int cell_width, cell_height;
+    render_cell_size(job->opts->mode, &cell_width, &cell_height);
+
+    y0 *= cell_height;
+    y1 *= cell_height;
+
+    luma_plane(
+        job->luma + (size_t) y0 * width,
+        job->image + (size_t) y0 * width * 4,
+        (size_t) (y1 - y0) * width
+    );
+}
+
+static uint8_t clamp_channel(int32_t value) {
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+// Round the channels of the `width` RGBA pixels of `row`, pixel row `line`,
+// to the `--quantize` levels, dithered.
+static const uint8_t* quantize_row(
+    const render_job* job,
+    render_scratch*   scratch,
+    const uint8_t*    row,
+    int               line
+) {
+    const render_opts* opts  = job->opts;
+    uint8_t*           out   = scratch->quantized;
+    diffuser*          error = &scratch->color_error;
+
+    for (int x = 0; x < opts->width; x++) {
+        int offset = 0;
+
+        if (opts->dither == DITHER_ORDERED) {
+            offset = job->quant_offsets[dither_threshold(x, line)];
+        }
+
+        for (int c = 0; c < 3; c++) {
+            int32_t value = row[x * 4 + c] + offset;
+
+            if (opts->dither == DITHER_DIFFUSE) {
+                value = clamp_channel(value + diffuser_error(error, x, c));
+            }
+
+            out[x * 4 + c] = job->quant_table[clamp_channel(value)];
+
+            if (opts->dither == DITHER_DIFFUSE) {
+                diffuser_spread(error, x, c, value - out[x * 4 + c]);
+            }
+        }
+    }
+
+    if (opts->dither == DITHER_DIFFUSE) diffuser_next(error);
+
+    return out;
+}
+
+// Map the `width` RGBA pixels of `row`, pixel row `line`, to xterm-256
+// colors, dithered.
+static void xterm_dither_row(
+    const render_job* job,
+    render_scratch*   scratch,
+    const uint8_t*    row,
+    int               line
+) {
+    const render_opts* opts  = job->opts;
+    diffuser*          error = &scratch->color_error;
+
+    for (int x = 0; x < opts->width; x++) {
+        uint8_t rgb[3];
+
+        if (opts->dither == DITHER_ORDERED) {
+            int offset = job->xterm_offsets[dither_threshold(x, line)];
+
+            for (int c = 0; c < 3; c++) {
+                rgb[c] = clamp_channel(row[x * 4 + c] + offset);
+            }
+
+            scratch->xterm[x] = rgb_to_xterm(rgb[0], rgb[1], rgb[2]);
+            continue;
+        }
+
+        for (int c = 0; c < 3; c++) {
+            int32_t value = row[x * 4 + c] + diffuser_error(error, x, c);
+
+            rgb[c] = clamp_channel(value);
+        }
+
+        uint8_t index = rgb_to_xterm(rgb[0], rgb[1], rgb[2]);
+        uint8_t shown[3];
+
+        xterm_rgb(index, shown);
+
+        for (int c = 0; c < 3; c++) {
+            diffuser_spread(error, x, c, rgb[c] - shown[c]);
+        }
+
+        scratch->xterm[x] = index;
+    }
+
+    if (opts->dither == DITHER_DIFFUSE) diffuser_next(error);
+}
+
+// Map the `width` RGBA pixels of `row`, pixel row `line` of the colors, to
+// the foreground colors of `cells`, or to their backgrounds. Only the last
+// rounding step, the quantization or the xterm palette, is dithered.
+static void render_colors(
+    const render_job* job,
+    render_scratch*   scratch,
+    const uint8_t*    row,
+    int               line,
+    cell*             cells,
+    bool              background
+) {
+    const render_opts* opts = job->opts;
+
+    uint8_t* xterm = scratch->xterm;
+    uint8_t* ansi  = scratch->ansi;
+
+    if (opts->ansi) {
+        if (opts->has_quant) {
+            ansi_map_row(
+                ansi,
+                row,
+                opts->width,
+                job->quant_levels,
+                opts->quant
+            );
+        } else {
+            ansi_map_row(ansi, row, opts->width, NULL, 255);
+        }
+    }
+
+    bool rgb = (opts->xterm || opts->truecolor) && !opts->ansi;
+
+    bool dither = opts->dither != DITHER_NONE;
+
+    if (rgb && opts->has_quant && dither) {
+        row = quantize_row(job, scratch, row, line);
+    } else if (rgb && opts->has_quant) {
+        for (int i = 0; i < opts->width * 4; i++) {
+            scratch->quantized[i] = job->quant_table[row[i]];
+        }
+
+        row = scratch->quantized;
+    }
+
+    if (rgb && !opts->truecolor) {
+        if (dither && !opts->has_quant) {
+            xterm_dither_row(job, scratch, row, line);
+        } else {
+            xterm_map_row(xterm, row, opts->width);
+        }
+    }
+
+    for (int x = 0; x < opts->width; x++) {
+        const uint8_t* pixel = row + x * 4;
+        sgr_color      color;
+
+        // an ansi escape resets the foreground, so it overrides the others
+        if (opts->ansi) {
+            color = ansi[x];
+        } else if (opts->truecolor) {
+            color = SGR_RGB | (uint32_t) pixel[0] << 16 |
+                    (uint32_t) pixel[1] << 8 | pixel[2];
+        } else if (opts->xterm) {
+            color = SGR_XTERM + xterm[x];
+        } else {
+            color = SGR_DEFAULT;
+        }
+
+        if (background) {
+            cells[x].background = color;
+        } else {
+            cells[x].color = color;
+        }
+    }
+}
+
+static void ascii_cells(
+    const render_job* job,
+    render_scratch*   scratch,
+    int               y,
+    cell*             cells
+) {
+    const render_opts* opts = job->opts;
+    const uint16_t*    luma = job->luma + (size_t) y * opts->width;
+    const uint8_t*     row  = job->image + (size_t) y * opts->width * 4;
+
+    uint8_t* edge = scratch->edge;
+
+    bool has_edge = opts->edge && y > 1 && y < opts->height - 1;
+
+    if (has_edge) edge_row(edge, luma, opts->width);
+
+    render_colors(job, scratch, row, y, cells, false);
+
+    int32_t   levels = job->table_len - 1;
+    diffuser* error  = &scratch->glyph_error;
+
+    for (int x = 0; x < opts->width; x++) {
+        cells[x].background = SGR_DEFAULT;
+
+        if (has_edge && edge[x] != EDGE_NONE) {
+            cells[x].glyph = edges[edge[x]];
+            continue;
+        }
+
+        int32_t value = luma[x];
+        int     idx;
+
+        if (opts->dither == DITHER_DIFFUSE) {
+            value += diffuser_error(error, x, 0);
+            value = MAX(MIN(value, LUMA_MAX), 0);
+
+            idx = (value * levels + LUMA_MAX / 2) / LUMA_MAX;
+
+            diffuser_spread(error, x, 0, value - idx * LUMA_MAX / levels);
+        } else {
+            if (opts->dither == DITHER_ORDERED) {
+                value += job->ramp_offsets[dither_threshold(x, y)];
+                value  = MIN(value, LUMA_MAX);
+            }
+
+            idx = (uint32_t) value * levels / LUMA_MAX;
+        }
+
+        cells[x].glyph = tables[opts->detail][idx];
+    }
+
+    if (opts->dither == DITHER_DIFFUSE) diffuser_next(error);
+}
+
+// Whether the pixel at `x`, `y` with luminance `luma` is drawn as a lit dot
+// or half block, dithered.
+static int render_dot(
+    const render_job* job,
+    render_scratch*   scratch,
+    int32_t           luma,
+    int               x,
+    int               y
+) {
+    switch (job->opts->dither) {
+    case DITHER_ORDERED:
+        return luma > job->dot_thresholds[dither_threshold(x, y)];
+    case DITHER_DIFFUSE: {
+        int32_t value = luma + diffuser_error(&scratch->glyph_error, x, 0);
+        int     lit   = value > DOT_THRESHOLD;
+
+        diffuser_spread(
+            &scratch->glyph_error,
+            x,
+            0,
+            value - (lit ? LUMA_MAX : 0)
+        );
+
+        return lit;
+    }
+    default:
+        return luma > DOT_THRESHOLD;
+    }
+}
+
+static void half_cells(
+    const render_job* job,
+    render_scratch*   scratch,
+    int               y,
+    cell*             cells
+) {
+    const render_opts* opts  = job->opts;
+    size_t             width = opts->width;
+
+    const uint8_t* top    = job->image + y * 2 * width * 4;
+    const uint8_t* bottom = top + width * 4;
+
+    // the upper half in the foreground color over the lower half in the
+    // background color
+    if (opts->ansi || opts->xterm || opts->truecolor) {
+        render_colors(job, scratch, top, y * 2, cells, false);
+        render_colors(job, scratch, bottom, y * 2 + 1, cells, true);
+
+        for (size_t x = 0; x < width; x++) cells[x].glyph = HALF_UPPER;
+
+        if (!opts->ansi) return;
+
+        const uint16_t* upper = job->luma + y * 2 * width;
+        const uint16_t* lower = upper + width;
+
+        for (size_t x = 0; x < width; x++) {
+            if (cells[x].color == SGR_DEFAULT) {
+                cells[x].color = ansi_grays[upper[x] * 4 / (LUMA_MAX + 1)];
+            }
+
+            if (cells[x].background == SGR_DEFAULT) {
+                cells[x].background = ansi_grays[lower[x] * 4 / (LUMA_MAX + 1)];
+            }
+        }
+
+        return;
+    }
+
+    uint8_t* halves = scratch->dots;
+
+    memset(halves, 0, width);
+
+    for (int line = 0; line < 2; line++) {
+        const uint16_t* luma = job->luma + (y * 2 + line) * width;
+
+        for (size_t x = 0; x < width; x++) {
+            int lit = render_dot(job, scratch, luma[x], x, y * 2 + line);
+
+            halves[x] |= lit << line;
+        }
+
+        if (opts->dither == DITHER_DIFFUSE) {
+            diffuser_next(&scratch->glyph_error);
+        }
+    }
+
+    for (size_t x = 0; x < width; x++) {
+        cells[x] = (cell) {
+            .color      = SGR_DEFAULT,
+            .background = SGR_DEFAULT,
+            .glyph      = half_blocks[halves[x]],
+        };
+    }
+}
+
+// Color each of `cells` with the average color of its pixels, when colors
+// are enabled.
+static void average_colors(
+    const render_job* job,
+    render_scratch*   scratch,
+    int               y,
+    cell*             cells
+) {
+    const render_opts* opts  = job->opts;
+    size_t             width = opts->width;
+
+    if (!opts->ansi && !opts->xterm && !opts->truecolor) {
+        for (size_t x = 0; x < width; x++) cells[x].color = SGR_DEFAULT;
+
+        return;
+    }
+
+    int cell_width, cell_height;
+    render_cell_size(opts->mode, &cell_width, &cell_height);
+
+    size_t         stride  = (size_t) job->pixel_width * 4;
+    const uint8_t* row     = job->image + y * cell_height * stride;
+    uint8_t*       average = scratch->average;
+    uint32_t       count   = cell_width * cell_height;
+
+    for (size_t i = 0; i < width * 4; i++) {
+        size_t   x   = i / 4;
+        size_t   c   = i % 4;
+        uint32_t sum = count / 2;
+
+        for (int line = 0; line < cell_height; line++) {
+            const uint8_t* p = row + line * stride + x * cell_width * 4 + c;
+
+            for (int dx = 0; dx < cell_width; dx++) sum += p[dx * 4];
+        }
+
+        average[i] = sum / count;
+    }
+
+    render_colors(job, scratch, average, y, cells, false);
+}
+
+static void braille_cells(
+    const render_job* job,
+    render_scratch*   scratch,
+    int               y,
+    cell*             cells
+) {
+    const render_opts* opts   = job->opts;
+    size_t             width  = opts->width;
+    size_t             pixels = width * 2;
+
+    const uint16_t* luma = job->luma + y * 4 * pixels;
+    uint8_t*        dots = scratch->dots;
+
+    memset(dots, 0, width);
+
+    // one line of dots at a time, without branches so it vectorizes
+    for (int line = 0; line < 4; line++) {
+        const uint16_t* l = luma + line * pixels;
+
+        int left  = braille_left[line];
+        int right = braille_right[line];
+        int py    = y * 4 + line;
+
+        if (opts->dither == DITHER_NONE) {
+            for (size_t x = 0; x < width; x++) {
+                dots[x] |= (l[x * 2] > DOT_THRESHOLD) << left |
+                           (l[x * 2 + 1] > DOT_THRESHOLD) << right;
+            }
+
+            continue;
+        }
+
+        for (size_t x = 0; x < width; x++) {
+            int px = x * 2;
+
+            dots[x] |= render_dot(job, scratch, l[px], px, py) << left |
+                       render_dot(job, scratch, l[px + 1], px + 1, py) << right;
+        }
+
+        if (opts->dither == DITHER_DIFFUSE) {
+            diffuser_next(&scratch->glyph_error);
+        }
+    }
+
+    // the dots share one color, the average of the cell
+    average_colors(job, scratch, y, cells);
+
+    for (size_t x = 0; x < width; x++) {
+        cells[x].background = SGR_DEFAULT;
+        cells[x].glyph      = BRAILLE_BLANK + dots[x];
+    }
+}
+
+static void shape_cells(
+    const render_job* job,
+    render_scratch*   scratch,
+    int               y,
+    cell*             cells
+) {
+    size_t width  = job->opts->width;
+    size_t stride = job->pixel_width;
+
+    shape_row(
+        scratch->shapes,
+        job->luma + y * SHAPE_HEIGHT * stride,
+        stride,
+        width,
+        tables[job->opts->detail],
+        job->table_len
+    );
+
+    average_colors(job, scratch, y, cells);
+
+    for (size_t x = 0; x < width; x++) {
+        cells[x].background = SGR_DEFAULT;
+        cells[x].glyph      = scratch->shapes[x];
+    }
+}
+
+// Glyph and colors of every cell in row `y`.
+static void render_cells(
+    const render_job* job,
+    render_scratch*   scratch,
+    int               y,
+    cell*             cells
+) {
+    switch (job->opts->mode) {
+    case RENDER_ASCII:
+        ascii_cells(job, scratch, y, cells);
+        break;
+    case RENDER_HALF:
+        half_cells(job, scratch, y, cells);
+        break;
+    case RENDER_BRAILLE:
+        braille_cells(job, scratch, y, cells);
+        break;
+    case RENDER_SHAPE:
+        shape_cells(job, scratch, y, cells);
+        break;
+    }
+}
+
+static void render_task(void* data, int band) {
+    const render_job*  job   = data;
+    const render_opts* opts  = job->opts;
+    frame*             frame = &job->slices[band];
+    int                y0, y1;
+
+    band_rows(job, job->bands, band, &y0, &y1);
+
+    render_scratch scratch;
+    scratch_init(&scratch, job);
+
+    cell*   cells = malloc((size_t) opts->width * sizeof *cells);
+    sgr_pen pen   = {SGR_DEFAULT, SGR_DEFAULT};
+
+    for (int y = y0; y < y1; y++) {
+        frame_push_repeat(frame, ' ', job->pad_cols);
+
+        render_cells(job, &scratch, y, cells);
+
+        for (int x = 0; x < opts->width; x++) {
+            cell_push(frame, &pen, &cells[x]);
+        }
+
+        sgr_reset(frame, &pen);
+        frame_push(frame, '\n');
+    }
+
+    scratch_free(&scratch);
+    free(cells);
+}
+
+static void grid_task(void* data, int band) {
+    const render_job* job   = data;
+    int               width = job->opts->width;
+    int               y0, y1;
+
+    band_rows(job, job->bands, band, &y0, &y1);
+
+    render_scratch scratch;
+    scratch_init(&scratch, job);
+
+    for (int y = y0; y < y1; y++) {
+        render_cells(job, &scratch, y, job->grid->cells + (size_t) y * width);
+    }
+
+    scratch_free(&scratch);
+}
+
+// Set up the parts of `job` shared by `render` and `render_grid`.
+static void render_job_init(
+    render_job*        job,
+    const uint8_t*     image,
+    const render_opts* opts,
+    pool*              pool
+) {
+    int pixel_width, pixel_height;
+    render_pixels(opts, &pixel_width, &pixel_height);
+
+    *job = (render_job) {
+        .image        = image,
+        .opts         = opts,
+        .luma         = malloc((size_t) pixel_width * pixel_height * 2),
+        .table_len    = strlen(tables[opts->detail]),
+        .pixel_width  = pixel_width,
+        .pixel_height = pixel_height,
+        .bands        = MAX(MIN(pool_threads(pool), opts->height), 1),
+    };
+
+    job->luma_bands = job->bands;
+
+    // diffusion carries the error down from row to row, split into bands
+    // it would start over at every band and show their seams
+    if (opts->dither == DITHER_DIFFUSE) job->bands = 1;
+
+    if (opts->has_quant) {
+        for (int i = 0; i < 256; i++) {
+            job->quant_table[i]  = quantize(i, opts->quant);
+            job->quant_levels[i] = quant_level(i, opts->quant);
+        }
+    }
+
+    // the ramp truncates, so its offsets cover a whole step, the others
+    // round and are centered on 0
+    if (opts->dither == DITHER_ORDERED) {
+        int32_t ramp_step = LUMA_MAX / (job->table_len - 1);
+        int32_t quant     = opts->has_quant ? opts->quant : 1;
+
+        for (int t = 0; t < DITHER_LEVELS; t++) {
+            int32_t twice = 2 * t + 1;
+
+            job->ramp_offsets[t]   = twice * ramp_step / (2 * DITHER_LEVELS);
+            job->dot_thresholds[t] = twice * LUMA_MAX / (2 * DITHER_LEVELS);
+
+            twice -= DITHER_LEVELS;
+
+            job->quant_offsets[t] = twice * 255 / (2 * DITHER_LEVELS * quant);
+            job->xterm_offsets[t] = twice * XTERM_STEP / (2 * DITHER_LEVELS);
+        }
+    }
+}
+
+// Blank rows above and columns left of the image.
+static void render_padding(const render_opts* opts, int* rows, int* cols) {
+    *rows = opts->center ? (opts->rows - opts->height) / 2 : 0;
+    *cols = opts->center ? (opts->columns - opts->width) / 2 : 0;
+
+    *rows = MAX(*rows, 0);
+    *cols = MAX(*cols, 0);
+}
+
+void render(
+    frame*             frame,
+    const uint8_t*     image,
+    const render_opts* opts,
+    pool*              pool
+) {
+    int pad_rows, pad_cols;
+    render_padding(opts, &pad_rows, &pad_cols);
+
+    size_t row_max = pad_cols + opts->width * CELL_MAX + sizeof("\e[0m\n");
+
+    frame_reserve(frame, pad_rows * 2 + 1 + opts->height * row_max);
+
+    render_job job;
+    render_job_init(&job, image, opts, pool);
+
+    job.pad_cols = pad_cols;
+
+    // a single band renders straight into the frame
+    if (job.bands == 1) {
+        job.slices = frame;
+    } else {
+        job.slices = calloc(job.bands, sizeof *job.slices);
+
+        for (int i = 0; i < job.bands; i++) {
+            int y0, y1;
+            band_rows(&job, job.bands, i, &y0, &y1);
+            frame_init(&job.slices[i], (y1 - y0) * row_max);
+        }
+    }
+
+    frame_push_repeat(frame, '\n', pad_rows);
+    frame_push(frame, '\n');
+
+    pool_run(pool, luma_task, &job, job.luma_bands);
+    pool_run(pool, render_task, &job, job.bands);
+
+    if (job.slices != frame) {
+        for (int i = 0; i < job.bands; i++) {
+            frame_push_bytes(frame, job.slices[i].data, job.slices[i].size);
+            frame_free(&job.slices[i]);
+        }
+
+        free(job.slices);
+    }
+
+    frame_push_repeat(frame, '\n', pad_rows);
+
+    free(job.luma);
+}
+
+void render_grid(
+    grid*              grid,
+    const uint8_t*     image,
+    const render_opts* opts,
+    pool*              pool
+) {
+    int pad_rows, pad_cols;
+    render_padding(opts, &pad_rows, &pad_cols);
+
+    grid_resize(grid, opts->width, opts->height);
+
+    // where `render` puts the image, below its leading empty line
+    grid->top  = pad_rows + 1;
+    grid->left = pad_cols;
+
+    render_job job;
+    render_job_init(&job, image, opts, pool);
+
+    job.grid = grid;
+
+    pool_run(pool, luma_task, &job, job.luma_bands);
+    pool_run(pool, grid_task, &job, job.bands);
+
+    free(job.luma);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dither.h"
+#include "frame.h"
+#include "grid.h"
+#include "pool.h"
+#include "shape.h"
+
+// How the pixels of the image are drawn into cells.
+typedef enum render_mode {
+    // one pixel per cell, as a glyph of `detail`
+    RENDER_ASCII   = 0,
+    // two pixels per cell, one above the other, as half blocks
+    RENDER_HALF    = 1,
+    // two by four pixels per cell, as Braille dots
+    RENDER_BRAILLE = 2,
+    // a patch of pixels per cell, as the glyph of the nearest shape
+    RENDER_SHAPE   = 3,
+} render_mode;
+
+typedef struct render_opts {
+    // in cells
+    int  width;
+    int  height;
+
+    // terminal size, used for centering
+    int  columns;
+    int  rows;
+
+    bool center;
+    bool edge;
+    bool ansi;
+    bool xterm;
+    bool truecolor;
+
+    render_mode mode;
+    int         detail;
+    dither_mode dither;
+
+    // levels per channel, 1 to 255
+    int  quant;
+    bool has_quant;
+} render_opts;
+
+// Pixels per cell in `mode`.
+static inline void render_cell_size(
+    render_mode mode,
+    int*        width,
+    int*        height
+) {
+    switch (mode) {
+    case RENDER_HALF:
+        *width  = 1;
+        *height = 2;
+        break;
+    case RENDER_BRAILLE:
+        *width  = 2;
+        *height = 4;
+        break;
+    case RENDER_SHAPE:
+        *width  = SHAPE_WIDTH;
+        *height = SHAPE_HEIGHT;
+        break;
+    default:
+        *width  = 1;
+        *height = 1;
+        break;
+    }
+}
+
+// Size in pixels of the image rendered with `opts`.
+static inline void render_pixels(
+    const render_opts* opts,
+    int*               width,
+    int*               height
+) {
+    render_cell_size(opts->mode, width, height);
+
+    *width  *= opts->width;
+    *height *= opts->height;
+}
+
+// Render the scaled RGBA `image`, sized by `render_pixels`, into `frame`,
+// splitting the rows across the threads of `pool` if it is not `NULL`.
+void render(
+    frame*             frame,
+    const uint8_t*     image,
+    const render_opts* opts,
+    pool*              pool
+);
+
+// Render into the cells of `grid` instead, resized to the image, for
+// drawing with `grid_diff`.
+void render_grid(
+    grid*              grid,
+    const uint8_t*     image,
+    const render_opts* opts,
+    pool*              pool
+);
@@ -0,0 +1,72 @@
+#include "sgr.h"
+
+// longest escape, `\e[38;2;255;255;255;48;2;255;255;255m`
+#define SGR_MAX 38
+
+// Write `value` in decimal to `out`, returns the end.
+static char* put_u8(char* out, uint8_t value) {
+    if (value >= 100) {
+        *out++ = '0' + value / 100;
+        *out++ = '0' + value / 10 % 10;
+    } else if (value >= 10) {
+        *out++ = '0' + value / 10;
+    }
+
+    *out++ = '0' + value % 10;
+
+    return out;
+}
+
+// Write the parameters selecting `color` to `out`, returns the end. `ground`
+// is 0 for the foreground and 10 for the background, the offset between the
+// codes of the two.
+static char* put_color(char* out, sgr_color color, int ground) {
+    if (color == SGR_DEFAULT) return put_u8(out, 39 + ground);
+
+    if (color < SGR_XTERM) return put_u8(out, color + ground);
+
+    out    = put_u8(out, 38 + ground);
+    *out++ = ';';
+
+    if (color < SGR_RGB) {
+        *out++ = '5';
+        *out++ = ';';
+
+        return put_u8(out, color - SGR_XTERM);
+    }
+
+    *out++ = '2';
+    *out++ = ';';
+    out    = put_u8(out, color >> 16);
+    *out++ = ';';
+    out    = put_u8(out, color >> 8);
+    *out++ = ';';
+
+    return put_u8(out, color);
+}
+
+void sgr_emit(frame* frame, sgr_pen* pen, sgr_color fg, sgr_color bg) {
+    if (frame->capacity - frame->size < SGR_MAX) {
+        frame_reserve(frame, SGR_MAX);
+    }
+
+    char* out = frame->data + frame->size;
+
+    *out++ = '\e';
+    *out++ = '[';
+
+    if (fg == SGR_DEFAULT && bg == SGR_DEFAULT) {
+        *out++ = '0';
+    } else {
+        if (fg != pen->fg) out = put_color(out, fg, 0);
+        if (fg != pen->fg && bg != pen->bg) *out++ = ';';
+        if (bg != pen->bg) out = put_color(out, bg, 10);
+    }
+
+    *out++ = 'm';
+
+    frame->size = out - frame->data;
+
+    pen->fg = fg;
+    pen->bg = bg;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "frame.h"
+
+// Color set through SGR escapes. `SGR_DEFAULT` is the terminal default,
+// values below `SGR_XTERM` are ANSI foreground color codes, `SGR_XTERM` plus
+// an index is a color of the xterm-256 palette and `SGR_RGB` with the
+// channels in the low 24 bits is a 24-bit color.
+typedef uint32_t sgr_color;
+
+#define SGR_DEFAULT 0
+#define SGR_XTERM   0x100
+#define SGR_RGB     0x1000000
+
+// Foreground and background the terminal currently draws with.
+typedef struct sgr_pen {
+    sgr_color fg;
+    sgr_color bg;
+} sgr_pen;
+
+// Append the escape that switches `pen` to `fg` and `bg`, in one sequence
+// when both change.
+void sgr_emit(frame* frame, sgr_pen* pen, sgr_color fg, sgr_color bg);
+
+static inline void sgr_set(
+    frame*    frame,
+    sgr_pen*  pen,
+    sgr_color fg,
+    sgr_color bg
+) {
+    if (pen->fg != fg || pen->bg != bg) sgr_emit(frame, pen, fg, bg);
+}
+
+// Return to the default colors, used at the end of every line.
+static inline void sgr_reset(frame* frame, sgr_pen* pen) {
+    sgr_set(frame, pen, SGR_DEFAULT, SGR_DEFAULT);
+}
@@ -0,0 +1,159 @@
+#include "shape.h"
+
+#include <stdlib.h>
+
+#include "luma.h"
+
+// Bitmaps of the glyphs, a row of `SHAPE_WIDTH` pixels at a time from the
+// top, drawn with `#`.
+static const struct {
+    char        glyph;
+    const char* rows;
+} shape_font[] = {
+    {' ', "...." "...." "...." "...." "...." "...." "...." "...."},
+    {'.', "...." "...." "...." "...." "...." "...." ".#.." "...."},
+    {',', "...." "...." "...." "...." "...." ".#.." ".#.." "#..."},
+    {'\'', ".#.." ".#.." "...." "...." "...." "...." "...." "...."},
+    {'`', "#..." ".#.." "...." "...." "...." "...." "...." "...."},
+    {'"', "#.#." "#.#." "...." "...." "...." "...." "...." "...."},
+    {'^', ".#.." "#.#." "...." "...." "...." "...." "...." "...."},
+    {'-', "...." "...." "...." "...." "###." "...." "...." "...."},
+    {'_', "...." "...." "...." "...." "...." "...." "...." "####"},
+    {'~', "...." "...." "...." ".#.#" "#.#." "...." "...." "...."},
+    {'=', "...." "...." "...." "###." "...." "###." "...." "...."},
+    {'+', "...." "...." ".#.." ".#.." "###." ".#.." ".#.." "...."},
+    {':', "...." "...." ".#.." "...." "...." "...." ".#.." "...."},
+    {';', "...." "...." ".#.." "...." "...." ".#.." ".#.." "#..."},
+    {'!', ".#.." ".#.." ".#.." ".#.." ".#.." "...." ".#.." "...."},
+    {'|', ".#.." ".#.." ".#.." ".#.." ".#.." ".#.." ".#.." ".#.."},
+    {'/', "...#" "...#" "..#." "..#." ".#.." ".#.." "#..." "#..."},
+    {'\\', "#..." "#..." ".#.." ".#.." "..#." "..#." "...#" "...#"},
+    {'(', "..#." ".#.." "#..." "#..." "#..." "#..." ".#.." "..#."},
+    {')', ".#.." "..#." "...#" "...#" "...#" "...#" "..#." ".#.."},
+    {'[', "###." "#..." "#..." "#..." "#..." "#..." "#..." "###."},
+    {']', ".###" "...#" "...#" "...#" "...#" "...#" "...#" ".###"},
+    {'<', "...." "..#." ".#.." "#..." ".#.." "..#." "...." "...."},
+    {'>', "...." ".#.." "..#." "...#" "..#." ".#.." "...." "...."},
+    {'*', "...." "#.#." ".#.." "###." ".#.." "#.#." "...." "...."},
+    {'i', ".#.." "...." ".#.." ".#.." ".#.." ".#.." ".#.." "...."},
+    {'c', "...." "...." ".###" "#..." "#..." "#..." ".###" "...."},
+    {'o', "...." "...." ".##." "#..#" "#..#" "#..#" ".##." "...."},
+    {'x', "...." "...." "#..#" ".##." ".##." ".##." "#..#" "...."},
+    {'v', "...." "...." "#..#" "#..#" "#..#" ".##." ".##." "...."},
+    {'n', "...." "...." "###." "#..#" "#..#" "#..#" "#..#" "...."},
+    {'u', "...." "...." "#..#" "#..#" "#..#" "#..#" ".###" "...."},
+    {'b', "#..." "#..." "###." "#..#" "#..#" "#..#" "###." "...."},
+    {'d', "...#" "...#" ".###" "#..#" "#..#" "#..#" ".###" "...."},
+    {'p', "...." "...." "###." "#..#" "#..#" "###." "#..." "#..."},
+    {'q', "...." "...." ".###" "#..#" "#..#" ".###" "...#" "...#"},
+    {'T', "###." ".#.." ".#.." ".#.." ".#.." ".#.." ".#.." "...."},
+    {'L', "#..." "#..." "#..." "#..." "#..." "#..." "####" "...."},
+    {'J', "...#" "...#" "...#" "...#" "...#" "#..#" ".##." "...."},
+    {'7', "####" "...#" "..#." "..#." ".#.." ".#.." ".#.." "...."},
+    {'H', "#..#" "#..#" "#..#" "####" "#..#" "#..#" "#..#" "...."},
+    {'X', "#..#" "#..#" ".##." ".##." ".##." "#..#" "#..#" "...."},
+    {'O', ".##." "#..#" "#..#" "#..#" "#..#" "#..#" ".##." "...."},
+    {'0', ".##." "#..#" "#..#" "#.##" "##.#" "#..#" ".##." "...."},
+    {'8', ".##." "#..#" "#..#" ".##." "#..#" "#..#" ".##." "...."},
+    {'%', "##.#" "##.#" "..#." ".#.." ".#.." "#.##" "#.##" "...."},
+    {'#', "...." "#.#." "####" "#.#." "####" "#.#." "...." "...."},
+    {'M', "#..#" "####" "####" "#..#" "#..#" "#..#" "#..#" "...."},
+    {'W', "#..#" "#..#" "#..#" "#..#" "####" "####" "#..#" "...."},
+    {'@', ".##." "#..#" "#.##" "#.##" "#.##" "#..." ".###" "...."},
+};
+
+#define SHAPE_COUNT (sizeof shape_font / sizeof shape_font[0])
+
+// patches with less contrast than this are drawn from the ramp
+#define SHAPE_CONTRAST (LUMA_MAX / 8)
+
+static uint32_t shape_bits[SHAPE_COUNT];
+static int      shape_cover[SHAPE_COUNT];
+static int      shape_max_cover;
+
+void shape_init(void) {
+    for (size_t i = 0; i < SHAPE_COUNT; i++) {
+        uint32_t bits = 0;
+
+        for (int p = 0; p < SHAPE_WIDTH * SHAPE_HEIGHT; p++) {
+            bits |= (uint32_t) (shape_font[i].rows[p] == '#') << p;
+        }
+
+        shape_bits[i]  = bits;
+        shape_cover[i] = __builtin_popcount(bits);
+
+        if (shape_cover[i] > shape_max_cover) {
+            shape_max_cover = shape_cover[i];
+        }
+    }
+}
+
+// Glyph nearest to the patch at `luma`. The pixels brighter than the mean
+// of the patch give its shape, compared with the glyphs by Hamming distance,
+// and the mean gives how much of the cell the glyph should cover.
+static char shape_match(
+    const uint16_t* luma,
+    size_t          stride,
+    const char*     ramp,
+    size_t          ramp_len
+) {
+    uint32_t sum = 0;
+    uint16_t min = LUMA_MAX;
+    uint16_t max = 0;
+
+    for (int y = 0; y < SHAPE_HEIGHT; y++) {
+        for (int x = 0; x < SHAPE_WIDTH; x++) {
+            uint16_t l = luma[y * stride + x];
+
+            sum += l;
+            min  = l < min ? l : min;
+            max  = l > max ? l : max;
+        }
+    }
+
+    uint32_t mean = sum / (SHAPE_WIDTH * SHAPE_HEIGHT);
+
+    if (max - min < SHAPE_CONTRAST) {
+        return ramp[mean * (ramp_len - 1) / LUMA_MAX];
+    }
+
+    uint32_t bits = 0;
+
+    for (int y = 0; y < SHAPE_HEIGHT; y++) {
+        for (int x = 0; x < SHAPE_WIDTH; x++) {
+            int p = y * SHAPE_WIDTH + x;
+
+            bits |= (uint32_t) (luma[y * stride + x] > mean) << p;
+        }
+    }
+
+    int target = (mean * shape_max_cover + LUMA_MAX / 2) / LUMA_MAX;
+
+    int best       = 0;
+    int best_score = INT32_MAX;
+
+    for (size_t i = 0; i < SHAPE_COUNT; i++) {
+        int score = __builtin_popcount(bits ^ shape_bits[i]) +
+                    2 * abs(shape_cover[i] - target);
+
+        if (score < best_score) {
+            best       = i;
+            best_score = score;
+        }
+    }
+
+    return shape_font[best].glyph;
+}
+
+void shape_row(
+    char*           out,
+    const uint16_t* luma,
+    size_t          stride,
+    int             count,
+    const char*     ramp,
+    size_t          ramp_len
+) {
+    for (int i = 0; i < count; i++) {
+        out[i] = shape_match(luma + i * SHAPE_WIDTH, stride, ramp, ramp_len);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of the patch of pixels a glyph is matched against.
+#define SHAPE_WIDTH  4
+#define SHAPE_HEIGHT 8
+
+// Build the glyph bitmaps used by `shape_row`, call once before use.
+void shape_init(void);
+
+// Pick the glyph whose shape is nearest to each of the `count` patches of
+// `SHAPE_WIDTH` by `SHAPE_HEIGHT` pixels side by side in the luminance rows
+// starting at `luma`, which are `stride` pixels apart. Patches without
+// enough contrast to have a shape get the glyph of `ramp` for their mean
+// luminance instead.
+void shape_row(
+    char*           out,
+    const uint16_t* luma,
+    size_t          stride,
+    int             count,
+    const char*     ramp,
+    size_t          ramp_len
+);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <errno.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Deadlines on the monotonic clock, needs `_POSIX_C_SOURCE` 200112 or later.
+
+static inline void timing_add_ms(struct timespec* time, long ms) {
+    time->tv_sec  += ms / 1000;
+    time->tv_nsec += ms % 1000 * 1000000;
+
+    if (time->tv_nsec >= 1000000000) {
+        time->tv_sec  += 1;
+        time->tv_nsec -= 1000000000;
+    }
+}
+
+static inline bool timing_before(
+    const struct timespec* a,
+    const struct timespec* b
+) {
+    if (a->tv_sec != b->tv_sec) return a->tv_sec < b->tv_sec;
+
+    return a->tv_nsec < b->tv_nsec;
+}
+
+static inline void timing_sleep_until(const struct timespec* deadline) {
+    int result;
+
+    do {
+        result = clock_nanosleep(
+            CLOCK_MONOTONIC,
+            TIMER_ABSTIME,
+            deadline,
+            NULL
+        );
+    } while (result == EINTR);
+}
@@ -0,0 +1,58 @@
+#include "xterm.h"
+
+// Both distances in the palette search are sums of per channel squares,
+// so everything but the final comparison comes from small tables.
+// `cube_dist[c]` is the squared distance of a channel to its level in the
+// color cube, `gray_index[r + g + b]` the step of the gray ramp.
+static uint8_t  cube_index[256];
+static uint16_t cube_dist[256];
+static uint16_t square[256];
+static uint8_t  gray_index[3 * 255 + 1];
+
+void xterm_init(void) {
+    for (int c = 0; c < 256; c++) {
+        int i     = (c < 48) ? 0 : (c < 115) ? 1 : (c - 35) / 40;
+        int level = (i == 0) ? 0 : 55 + i * 40;
+
+        cube_index[c] = i;
+        cube_dist[c]  = (c - level) * (c - level);
+        square[c]     = c * c;
+    }
+
+    for (int sum = 0; sum <= 3 * 255; sum++) {
+        int avg = sum / 3;
+
+        gray_index[sum] = (avg > 238) ? 23 : (avg - 3) / 10;
+    }
+}
+
+uint8_t rgb_to_xterm(uint8_t r, uint8_t g, uint8_t b) {
+    int32_t sum   = r + g + b;
+    int32_t gray  = gray_index[sum];
+    int32_t level = 8 + gray * 10;
+
+    int32_t color_dist = cube_dist[r] + cube_dist[g] + cube_dist[b];
+    int32_t gray_dist  = square[r] + square[g] + square[b] -
+                        2 * level * sum + 3 * level * level;
+
+    if (gray_dist < color_dist) return 232 + gray;
+
+    return 16 + 36 * cube_index[r] + 6 * cube_index[g] + cube_index[b];
+}
+
+void xterm_rgb(uint8_t index, uint8_t* rgb) {
+    if (index >= 232) {
+        rgb[0] = rgb[1] = rgb[2] = 8 + (index - 232) * 10;
+        return;
+    }
+
+    int cube[3] = {(index - 16) / 36, (index - 16) / 6 % 6, (index - 16) % 6};
+
+    for (int c = 0; c < 3; c++) rgb[c] = cube[c] ? 55 + cube[c] * 40 : 0;
+}
+
+void xterm_map_row(uint8_t* out, const uint8_t* rgba, size_t count) {
+    for (size_t i = 0; i < count; i++, rgba += 4) {
+        out[i] = rgb_to_xterm(rgba[0], rgba[1], rgba[2]);
+    }
+}
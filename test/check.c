@@ -0,0 +1,466 @@
+// Checks the optimized stages against straightforward reference versions,
+// and the rendered output against the output stored in `test/golden`.
+// Prints every failure and exits with 1 if there was any.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ansi.h"
+#include "edge.h"
+#include "frame.h"
+#include "luma.h"
+#include "pool.h"
+#include "render.h"
+#include "shape.h"
+#include "xterm.h"
+
+#define COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+static int failures = 0;
+
+static void fail(const char* check, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    fprintf(stderr, "check %s: ", check);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+
+    va_end(args);
+
+    failures++;
+}
+
+// xorshift32, so the inputs are the same on every run
+static uint32_t next_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+// Luminance planes with noise, hard edged blocks and rings, which have
+// strong gradients in every direction.
+static void synthetic_plane(uint16_t* plane, int width, int height, int kind) {
+    uint32_t state = 0x2545f491 + kind;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint16_t* l = plane + y * width + x;
+
+            int dx = x - width / 2;
+            int dy = y - height / 2;
+
+            switch (kind) {
+            case 0:
+                *l = next_random(&state);
+                break;
+            case 1:
+                *l = (x / 7 + y / 5) % 3 * (LUMA_MAX / 2);
+                break;
+            default:
+                *l = (dx * dx + dy * dy) / (kind * 8) % 2 ? LUMA_MAX : 0;
+                *l ^= next_random(&state) & 0xfff;
+                break;
+            }
+        }
+    }
+}
+
+// The Sobel classification `edge_row` replaced, with `sqrtf` and `atan2`.
+static uint8_t edge_reference(const uint16_t* l, int width) {
+    const uint16_t* u = l - width;
+    const uint16_t* d = l + width;
+
+    int32_t dx = -u[-1] + u[1] - 2 * l[-1] + 2 * l[1] - d[-1] + d[1];
+    int32_t dy = -u[-1] - 2 * u[0] - u[1] + d[-1] + 2 * d[0] + d[1];
+
+    float m = sqrtf((int64_t) dx * dx + (int64_t) dy * dy);
+    float o = atan2(dy, dx);
+
+    if (!(m > 0.9 * LUMA_MAX)) return EDGE_NONE;
+
+    return (int) round((o / 3.14159 * 3.5 + 8.0)) % 8;
+}
+
+// `edge_row` on full rows, where most pixels take the SIMD path, must match
+// both the reference and the scalar path. The scalar path is reached by
+// classifying each pixel again from a copy of its 3x3 neighbourhood.
+static void check_edge(void) {
+    const int sizes[][2] = {{203, 37}, {64, 64}, {9, 50}};
+
+    for (size_t s = 0; s < COUNT(sizes); s++) {
+        int width  = sizes[s][0];
+        int height = sizes[s][1];
+
+        uint16_t* plane = malloc(width * height * sizeof(uint16_t));
+        uint8_t*  out   = malloc(width);
+
+        for (int kind = 0; kind < 6; kind++) {
+            synthetic_plane(plane, width, height, kind);
+
+            for (int y = 1; y < height - 1; y++) {
+                const uint16_t* row = plane + y * width;
+
+                edge_row(out, row, width);
+
+                for (int x = 1; x < width - 1; x++) {
+                    uint16_t block[9];
+                    uint8_t  single[3];
+
+                    for (int i = 0; i < 3; i++) {
+                        memcpy(
+                            block + i * 3,
+                            row + (i - 1) * width + x - 1,
+                            3 * sizeof(uint16_t)
+                        );
+                    }
+
+                    edge_row(single, block + 3, 3);
+
+                    int expected = edge_reference(row + x, width);
+
+                    if (out[x] != expected || single[1] != expected) {
+                        fail(
+                            "edge",
+                            "pixel %d,%d of plane %d is %d and %d, not %d",
+                            x,
+                            y,
+                            kind,
+                            out[x],
+                            single[1],
+                            expected
+                        );
+                    }
+                }
+            }
+        }
+
+        free(out);
+        free(plane);
+    }
+}
+
+// The float HSL classification `ansi_classify` replaced.
+static uint8_t ansi_reference(int red, int green, int blue) {
+    static const uint8_t colors[]      = {31, 33, 32, 36, 34, 35};
+    static const uint8_t colors_high[] = {91, 93, 92, 96, 94, 95};
+
+    float r = red / 255.0;
+    float g = green / 255.0;
+    float b = blue / 255.0;
+
+    float cmax = fmaxf(fmaxf(r, g), b);
+    float cmin = fminf(fminf(r, g), b);
+    float dc   = (cmax - cmin) / 2.0;
+    float h;
+
+    float l = (cmax + cmin) / 2.0;
+    float s = l < 0.5 ? dc / (cmax + cmin) : dc / (2.0 - cmax - cmin);
+
+    if (!(s > 0.1)) return 0;
+
+    if (cmax == r) {
+        h = fmodf((g - b) / dc, 6.0);
+    } else if (cmax == g) {
+        h = (b - r) / dc + 2.0;
+    } else {
+        h = (r - g) / dc + 4.0;
+    }
+
+    int index = (int) roundf(h + 5.5) % 6;
+
+    return l > 0.7 ? colors_high[index] : colors[index];
+}
+
+// Colors `ansi_classify` may map differently from the float version, as
+// documented there.
+#define ANSI_TOLERANCE 17598
+
+// Every 24-bit color must map like the float version did, or be exactly on
+// the saturation or lightness threshold. Grays are never colored.
+static void check_ansi(void) {
+    int differ = 0;
+
+    for (int r = 0; r < 256; r++) {
+        for (int g = 0; g < 256; g++) {
+            for (int b = 0; b < 256; b++) {
+                int color    = ansi_classify(r, g, b, 255);
+                int expected = ansi_reference(r, g, b);
+
+                if (r == g && g == b && color != 0) {
+                    fail("ansi", "gray %d is colored %d", r, color);
+                }
+
+                if (color == expected) continue;
+
+                int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+                int min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+                int sum = max + min;
+
+                bool tie = 5 * (max - min) == (sum < 255 ? sum : 510 - sum) ||
+                           10 * sum == 14 * 255;
+
+                if (!tie) {
+                    fail(
+                        "ansi",
+                        "%d,%d,%d is %d, not %d",
+                        r,
+                        g,
+                        b,
+                        color,
+                        expected
+                    );
+                }
+
+                differ++;
+            }
+        }
+    }
+
+    if (differ > ANSI_TOLERANCE) {
+        fail(
+            "ansi",
+            "%d colors differ, at most %d may",
+            differ,
+            ANSI_TOLERANCE
+        );
+    }
+}
+
+#define GOLDEN_COLUMNS 24
+#define GOLDEN_ROWS    12
+
+// Option set rendered and compared to `test/golden/<name>.txt`.
+typedef struct golden_set {
+    const char* name;
+    render_opts opts;
+} golden_set;
+
+static const golden_set goldens[] = {
+    {"plain", {.detail = 1}},
+    {"low", {.detail = 0}},
+    {"high", {.detail = 2}},
+    {"edge", {.detail = 1, .edge = true}},
+    {"ansi", {.detail = 1, .ansi = true}},
+    {"ansi-quant", {.detail = 1, .ansi = true, .quant = 3, .has_quant = 1}},
+    {"xterm", {.detail = 1, .xterm = true}},
+    {"xterm-quant", {.detail = 1, .xterm = true, .quant = 4, .has_quant = 1}},
+    {"truecolor", {.detail = 1, .truecolor = true}},
+    {"ordered", {.detail = 1, .xterm = true, .dither = DITHER_ORDERED}},
+    {"diffuse", {.detail = 1, .xterm = true, .dither = DITHER_DIFFUSE}},
+    {"half", {.detail = 1, .truecolor = true, .mode = RENDER_HALF}},
+    {"braille", {.detail = 1, .ansi = true, .mode = RENDER_BRAILLE}},
+    {"shape", {.detail = 1, .mode = RENDER_SHAPE}},
+};
+
+// Rendered from the image with black and white rows stacked.
+static const golden_set stacked_goldens[] = {
+    {"ansi-half", {.detail = 1, .ansi = true, .mode = RENDER_HALF}},
+};
+
+// Colors on the thresholds of the conversions: black, white, grays, ANSI
+// saturation and lightness ties, and the primaries.
+static const uint8_t swatches[][3] = {
+    {0, 0, 0},
+    {255, 255, 255},
+    {64, 64, 64},
+    {128, 128, 128},
+    {192, 192, 192},
+    {2, 2, 3},
+    {150, 100, 100},
+    {255, 102, 102},
+    {255, 0, 0},
+    {255, 255, 0},
+    {0, 255, 255},
+    {0, 0, 255},
+};
+
+// An image in four bands: the swatches, a hue sweep, a gray ramp and
+// rings for the edges and dots. With `stacked` the first band has black
+// over white pixels on the left and white over black on the right.
+static uint8_t* golden_image(int width, int height, bool stacked) {
+    uint8_t* image = malloc((size_t) width * height * 4);
+
+    for (int y = 0; y < height; y++) {
+        int band = y * 4 / height;
+        int v    = y * 4 * 256 / height % 256;
+
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = image + ((size_t) y * width + x) * 4;
+
+            int u = x * 256 / width;
+
+            switch (band) {
+            case 0: {
+                const uint8_t* swatch = swatches[u * COUNT(swatches) / 256];
+                int            white  = (y % 2) ^ (x >= width / 2);
+
+                if (stacked) {
+                    p[0] = p[1] = p[2] = white ? 255 : 0;
+                } else {
+                    memcpy(p, swatch, 3);
+                }
+                break;
+            }
+            case 1: {
+                int h6   = u * 6;
+                int f    = h6 & 255;
+                int rise = f * v / 255;
+                int fall = (255 - f) * v / 255;
+
+                uint8_t hues[6][3] = {
+                    {v, rise, 0},
+                    {fall, v, 0},
+                    {0, v, rise},
+                    {0, fall, v},
+                    {rise, 0, v},
+                    {v, 0, fall},
+                };
+
+                memcpy(p, hues[h6 >> 8], 3);
+                break;
+            }
+            case 2:
+                p[0] = p[1] = p[2] = u;
+                break;
+            default: {
+                int dx = u - 128;
+                int dy = v - 128;
+                int on = (dx * dx + dy * dy) / 512 % 2;
+
+                p[0] = on ? 255 : 0;
+                p[1] = on ? 255 : 0;
+                p[2] = on ? 255 : 128;
+                break;
+            }
+            }
+
+            p[3] = 255;
+        }
+    }
+
+    return image;
+}
+
+static bool read_golden(frame* golden, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    char   buffer[4096];
+    size_t count;
+
+    while ((count = fread(buffer, 1, sizeof buffer, file)) > 0) {
+        frame_push_bytes(golden, buffer, count);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+
+    return ok;
+}
+
+static bool write_golden(const frame* frame, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    bool ok = fwrite(frame->data, 1, frame->size, file) == frame->size;
+
+    return fclose(file) == 0 && ok;
+}
+
+// Render the golden image with every option set, on one thread and on a
+// pool, and compare both to the stored output. With `update` the stored
+// output is written instead.
+static void check_golden(bool update) {
+    pool* pool = pool_new(3);
+
+    frame output, threaded, golden;
+    frame_init(&output, 0);
+    frame_init(&threaded, 0);
+    frame_init(&golden, 0);
+
+    size_t count = COUNT(goldens) + COUNT(stacked_goldens);
+
+    for (size_t i = 0; i < count; i++) {
+        bool              stacked = i >= COUNT(goldens);
+        const golden_set* set =
+            stacked ? &stacked_goldens[i - COUNT(goldens)] : &goldens[i];
+
+        const char* name = set->name;
+        render_opts opts = set->opts;
+
+        opts.width  = GOLDEN_COLUMNS;
+        opts.height = GOLDEN_ROWS;
+
+        int width, height;
+        render_pixels(&opts, &width, &height);
+
+        uint8_t* image = golden_image(width, height, stacked);
+
+        frame_clear(&output);
+        frame_clear(&threaded);
+        frame_clear(&golden);
+
+        render(&output, image, &opts, NULL);
+        render(&threaded, image, &opts, pool);
+
+        free(image);
+
+        char path[256];
+        snprintf(path, sizeof path, "test/golden/%s.txt", name);
+
+        if (update) {
+            if (!write_golden(&output, path)) {
+                fail("golden", "could not write %s", path);
+            }
+
+            continue;
+        }
+
+        if (!read_golden(&golden, path)) {
+            fail("golden", "could not read %s", path);
+            continue;
+        }
+
+        if (output.size != golden.size ||
+            memcmp(output.data, golden.data, golden.size) != 0) {
+            fail("golden", "%s differs from %s", name, path);
+        }
+
+        if (threaded.size != output.size ||
+            memcmp(threaded.data, output.data, output.size) != 0) {
+            fail("golden", "%s differs on several threads", name);
+        }
+    }
+
+    frame_free(&golden);
+    frame_free(&threaded);
+    frame_free(&output);
+
+    pool_free(pool);
+}
+
+int main(int argc, char** argv) {
+    // `check update` rewrites the stored output instead of comparing to it
+    bool update = argc > 1 && strcmp(argv[1], "update") == 0;
+
+    xterm_init();
+    shape_init();
+
+    check_edge();
+    check_ansi();
+    check_golden(update);
+
+    if (failures) {
+        fprintf(stderr, "check: %d failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}